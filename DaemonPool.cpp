@@ -0,0 +1,148 @@
+#include "DaemonPool.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+const std::chrono::milliseconds DaemonPool::MIN_BACKOFF(250);
+const std::chrono::milliseconds DaemonPool::MAX_BACKOFF(30000);
+const std::chrono::milliseconds DaemonPool::REQUEST_TIMEOUT(5000);
+const std::string DaemonPool::JSON_RPC_URI("/json_rpc");
+
+// Whether body starts like a portable storage packet, as opposed to some page of a daemon that does not know the URI
+static bool isPortableStorage(boost::string_ref body) {
+  // Two signature words and the format version, as portable_storage::store_to_binary writes them
+  if (body.size() < 2 * sizeof(uint32_t) + 1) {
+    return false;
+  }
+
+  uint32_t signatureA;
+  uint32_t signatureB;
+  memcpy(&signatureA, body.data(), sizeof(signatureA));
+  memcpy(&signatureB, body.data() + sizeof(signatureA), sizeof(signatureB));
+  return signatureA == PORTABLE_STORAGE_SIGNATUREA && signatureB == PORTABLE_STORAGE_SIGNATUREB && static_cast<uint8_t>(body[2 * sizeof(uint32_t)]) == PORTABLE_STORAGE_FORMAT_VER;
+}
+
+DaemonPool::Endpoint::Endpoint(const std::string& address) : address(address), latency(-1), failures(0), retryTime(std::chrono::steady_clock::now()), binaryRejected(false) {
+}
+
+DaemonPool::DaemonPool(RpcClient* client, const std::vector<std::string>& addresses) : m_client(client), m_binaryTransport(true) {
+  for (const std::string& address : addresses) {
+    m_endpoints.push_back(std::make_shared<Endpoint>(address));
+  }
+}
+
+bool DaemonPool::empty() const {
+  return m_endpoints.empty();
+}
+
+void DaemonPool::setBinaryTransport(bool enabled) {
+  m_binaryTransport = enabled;
+}
+
+std::chrono::milliseconds DaemonPool::getRetryDelay() const {
+  if (m_endpoints.empty()) {
+    return MAX_BACKOFF;
+  }
+
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::time_point retryTime = std::chrono::steady_clock::time_point::max();
+  for (const std::shared_ptr<Endpoint>& endpoint : m_endpoints) {
+    std::lock_guard<std::mutex> lock(endpoint->mutex);
+    retryTime = std::min(retryTime, endpoint->retryTime);
+  }
+
+  if (retryTime <= now) {
+    return std::chrono::milliseconds(0);
+  }
+
+  // Rounded up, so that waiting for it never wakes up just before the endpoint is due
+  return std::chrono::duration_cast<std::chrono::milliseconds>(retryTime - now) + std::chrono::milliseconds(1);
+}
+
+std::string DaemonPool::getStatus() const {
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::ostringstream stream;
+  for (const std::shared_ptr<Endpoint>& endpoint : m_endpoints) {
+    std::lock_guard<std::mutex> lock(endpoint->mutex);
+    if (&endpoint != &m_endpoints.front()) {
+      stream << ", ";
+    }
+
+    stream << endpoint->address << ' ';
+    if (endpoint->retryTime > now) {
+      stream << "down, retry in " << std::chrono::duration_cast<std::chrono::milliseconds>(endpoint->retryTime - now).count() << " ms";
+    } else if (endpoint->latency < 0) {
+      stream << "untried";
+    } else {
+      stream << static_cast<uint64_t>(endpoint->latency) << " ms";
+    }
+  }
+
+  return stream.str();
+}
+
+// Healthy endpoints by increasing latency, untried ones first so that every endpoint gets measured
+std::vector<std::shared_ptr<DaemonPool::Endpoint>> DaemonPool::selectEndpoints(size_t count) const {
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::vector<std::pair<double, std::shared_ptr<Endpoint>>> candidates;
+  for (const std::shared_ptr<Endpoint>& endpoint : m_endpoints) {
+    std::lock_guard<std::mutex> lock(endpoint->mutex);
+    if (endpoint->retryTime <= now) {
+      candidates.push_back(std::make_pair(endpoint->latency, endpoint));
+    }
+  }
+
+  std::stable_sort(candidates.begin(), candidates.end(), [](const std::pair<double, std::shared_ptr<Endpoint>>& candidate1, const std::pair<double, std::shared_ptr<Endpoint>>& candidate2) {
+    return candidate1.first < candidate2.first;
+  });
+
+  std::vector<std::shared_ptr<Endpoint>> endpoints;
+  for (size_t i = 0; i < candidates.size() && i < count; ++i) {
+    endpoints.push_back(candidates[i].second);
+  }
+
+  return endpoints;
+}
+
+void DaemonPool::send(RpcClient* client, const std::shared_ptr<Endpoint>& endpoint, const Message& message, const std::function<Outcome(const boost::string_ref* answer, bool binary)>& accept, const std::function<void(bool accepted)>& settle) {
+  bool binary = !message.binary.empty();
+  if (binary) {
+    std::lock_guard<std::mutex> lock(endpoint->mutex);
+    binary = !endpoint->binaryRejected;
+  }
+
+  std::chrono::steady_clock::time_point time1 = std::chrono::steady_clock::now();
+  const std::string& uri = binary ? message.uri : JSON_RPC_URI;
+  std::string contentType = binary ? "application/octet-stream" : "application/json";
+  const std::string& body = binary ? message.binary : message.json;
+  client->post(endpoint->address, uri, contentType, body, REQUEST_TIMEOUT, [client, endpoint, message, binary, accept, settle, time1](unsigned int status, boost::string_ref answer) {
+    if (binary && (status == 404 || status == 405 || (status == 200 && !isPortableStorage(answer)))) {
+      // The daemon is up but does not know the URI, the JSON form goes out right away. Other error
+      // statuses may be passing, they count as a failure of the endpoint and leave the binary form on.
+      {
+        std::lock_guard<std::mutex> lock(endpoint->mutex);
+        endpoint->binaryRejected = true;
+      }
+
+      send(client, endpoint, message, accept, settle);
+      return;
+    }
+
+    Outcome outcome = accept(status == 200 ? &answer : nullptr, binary);
+    std::chrono::steady_clock::time_point time2 = std::chrono::steady_clock::now();
+    {
+      std::lock_guard<std::mutex> lock(endpoint->mutex);
+      if (outcome != FAILED) {
+        double latency = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(time2 - time1).count();
+        endpoint->latency = endpoint->latency < 0 ? latency : endpoint->latency * 0.75 + latency * 0.25;
+        endpoint->failures = 0;
+      } else {
+        ++endpoint->failures;
+        std::chrono::milliseconds backoff = MIN_BACKOFF * (static_cast<int64_t>(1) << std::min<size_t>(endpoint->failures - 1, 16));
+        endpoint->retryTime = time2 + std::min(backoff, MAX_BACKOFF);
+      }
+    }
+
+    settle(outcome == ACCEPTED);
+  });
+}
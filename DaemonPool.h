@@ -0,0 +1,265 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <boost/utility/string_ref.hpp>
+#include "RpcClient.h"
+#include "net/http_server_handlers_map2.h"
+#include "rpc/core_rpc_server_commands_defs.h"
+#include "storages/portable_storage_template_helper.h"
+
+// Daemons serving one chain, reached through the shared RpcClient. Requests go to the
+// fastest healthy endpoint, an endpoint whose request fails is skipped for an
+// exponentially growing delay. Answers are handled on the event loop thread of the
+// RpcClient, so no request holds up a thread of its own.
+class DaemonPool {
+public:
+  DaemonPool(RpcClient* client, const std::vector<std::string>& addresses);
+  bool empty() const;
+  // Calls method on the fastest healthy endpoint, or on the two fastest at once when hedged,
+  // and takes the result of the first one to succeed. response has to outlive the future.
+  template<class Command> std::future<bool> invoke(const std::string& method, const typename Command::request& request, bool hedged, typename Command::response* response);
+  // The same for a method the daemons may also serve in portable storage binary form at uri. Every
+  // endpoint gets the binary request until it answers one as a daemon that does not know the uri, from
+  // then on it gets the JSON one. binary tells which form the response was parsed from, the two forms share its type.
+  template<class Command, class BinaryCommand> std::future<bool> invoke(const std::string& method, const typename Command::request& request, const std::string& uri, const typename BinaryCommand::request& binaryRequest, bool hedged, typename Command::response* response, bool* binary);
+  // Calls method on every endpoint at once, the future gives the number of them it succeeded on
+  template<class Command> std::future<size_t> invokeAll(const std::string& method, const typename Command::request& request);
+  template<class Command, class BinaryCommand> std::future<size_t> invokeAll(const std::string& method, const typename Command::request& request, const std::string& uri, const typename BinaryCommand::request& binaryRequest);
+  // Sends the binary forms of methods that have one, on by default
+  void setBinaryTransport(bool enabled);
+  // Time until the next endpoint becomes healthy, zero while one is
+  std::chrono::milliseconds getRetryDelay() const;
+  std::string getStatus() const;
+
+private:
+  static const std::chrono::milliseconds MIN_BACKOFF;
+  static const std::chrono::milliseconds MAX_BACKOFF;
+  static const std::chrono::milliseconds REQUEST_TIMEOUT;
+  static const std::string JSON_RPC_URI;
+
+  // What became of a request. A daemon that answers with an error, such as a stale or duplicate
+  // block, is up and rejected it, only a request without a usable answer counts against the endpoint.
+  enum Outcome {
+    ACCEPTED,
+    REJECTED,
+    FAILED
+  };
+
+  struct Endpoint {
+    explicit Endpoint(const std::string& address);
+
+    std::string address;
+    std::mutex mutex;
+    // Moving average of the request time in milliseconds, negative until the first success
+    double latency;
+    size_t failures;
+    std::chrono::steady_clock::time_point retryTime;
+    // Answered a binary request with 404 or 405, or with something else than portable storage,
+    // so it only gets JSON ones
+    bool binaryRejected;
+  };
+
+  // A request in JSON-RPC form and, for methods that have one, in binary form
+  struct Message {
+    std::string json;
+    std::string uri;
+    std::string binary;
+  };
+
+  // Touched on the event loop thread only
+  struct Race {
+    size_t pending;
+    bool settled;
+    std::promise<bool> succeeded;
+  };
+
+  struct Tally {
+    size_t pending;
+    size_t succeeded;
+    std::promise<size_t> result;
+  };
+
+  RpcClient* m_client;
+  std::vector<std::shared_ptr<Endpoint>> m_endpoints;
+  std::atomic<bool> m_binaryTransport;
+
+  template<class Request> static std::string makeBody(const std::string& method, const Request& request);
+  template<class Request> static std::string makeBinaryBody(const Request& request);
+  template<class Response> static Outcome parseBody(boost::string_ref body, Response* response);
+  template<class Response> static Outcome parseBinaryBody(boost::string_ref body, Response* response);
+  template<class Command> std::future<bool> invoke(const Message& message, bool hedged, typename Command::response* response, bool* binary);
+  template<class Command, class BinaryCommand> std::future<size_t> invokeAll(const Message& message);
+  std::vector<std::shared_ptr<Endpoint>> selectEndpoints(size_t count) const;
+  // Posts message to endpoint and has accept check the answer, nullptr when there is none. The health
+  // of the endpoint is updated before settle learns whether the answer was accepted, only a FAILED
+  // outcome backs the endpoint off. Static, as answers may come in after the pool is gone.
+  static void send(RpcClient* client, const std::shared_ptr<Endpoint>& endpoint, const Message& message, const std::function<Outcome(const boost::string_ref* answer, bool binary)>& accept, const std::function<void(bool accepted)>& settle);
+};
+
+template<class Command> std::future<bool> DaemonPool::invoke(const std::string& method, const typename Command::request& request, bool hedged, typename Command::response* response) {
+  Message message;
+  message.json = makeBody(method, request);
+  return invoke<Command>(message, hedged, response, nullptr);
+}
+
+template<class Command, class BinaryCommand> std::future<bool> DaemonPool::invoke(const std::string& method, const typename Command::request& request, const std::string& uri, const typename BinaryCommand::request& binaryRequest, bool hedged, typename Command::response* response, bool* binary) {
+  Message message;
+  message.json = makeBody(method, request);
+  if (m_binaryTransport) {
+    message.uri = uri;
+    message.binary = makeBinaryBody(binaryRequest);
+  }
+
+  return invoke<Command>(message, hedged, response, binary);
+}
+
+template<class Command> std::future<bool> DaemonPool::invoke(const Message& message, bool hedged, typename Command::response* response, bool* binary) {
+  std::shared_ptr<Race> race = std::make_shared<Race>();
+  std::future<bool> succeeded = race->succeeded.get_future();
+  std::vector<std::shared_ptr<Endpoint>> endpoints = selectEndpoints(hedged ? 2 : 1);
+  if (endpoints.empty()) {
+    race->succeeded.set_value(false);
+    return succeeded;
+  }
+
+  race->pending = endpoints.size();
+  race->settled = false;
+  for (const std::shared_ptr<Endpoint>& endpoint : endpoints) {
+    std::shared_ptr<typename Command::response> candidate = std::make_shared<typename Command::response>();
+    std::shared_ptr<bool> candidateBinary = std::make_shared<bool>(false);
+    send(m_client, endpoint, message, [candidate, candidateBinary](const boost::string_ref* answer, bool binary) {
+      *candidateBinary = binary;
+      if (answer == nullptr) {
+        return FAILED;
+      }
+
+      return binary ? parseBinaryBody(*answer, candidate.get()) : parseBody(*answer, candidate.get());
+    }, [race, candidate, candidateBinary, response, binary](bool accepted) {
+      --race->pending;
+      if (!race->settled && (accepted || race->pending == 0)) {
+        if (accepted) {
+          *response = std::move(*candidate);
+          if (binary != nullptr) {
+            *binary = *candidateBinary;
+          }
+        }
+
+        race->settled = true;
+        race->succeeded.set_value(accepted);
+      }
+    });
+  }
+
+  return succeeded;
+}
+
+template<class Command> std::future<size_t> DaemonPool::invokeAll(const std::string& method, const typename Command::request& request) {
+  Message message;
+  message.json = makeBody(method, request);
+  return invokeAll<Command, Command>(message);
+}
+
+template<class Command, class BinaryCommand> std::future<size_t> DaemonPool::invokeAll(const std::string& method, const typename Command::request& request, const std::string& uri, const typename BinaryCommand::request& binaryRequest) {
+  Message message;
+  message.json = makeBody(method, request);
+  if (m_binaryTransport) {
+    message.uri = uri;
+    message.binary = makeBinaryBody(binaryRequest);
+  }
+
+  return invokeAll<Command, BinaryCommand>(message);
+}
+
+template<class Command, class BinaryCommand> std::future<size_t> DaemonPool::invokeAll(const Message& message) {
+  std::shared_ptr<Tally> tally = std::make_shared<Tally>();
+  std::future<size_t> result = tally->result.get_future();
+  if (m_endpoints.empty()) {
+    tally->result.set_value(0);
+    return result;
+  }
+
+  tally->pending = m_endpoints.size();
+  tally->succeeded = 0;
+  for (const std::shared_ptr<Endpoint>& endpoint : m_endpoints) {
+    send(m_client, endpoint, message, [](const boost::string_ref* answer, bool binary) {
+      if (answer == nullptr) {
+        return FAILED;
+      }
+
+      if (binary) {
+        typename BinaryCommand::response response = AUTO_VAL_INIT(response);
+        return parseBinaryBody(*answer, &response);
+      }
+
+      typename Command::response response = AUTO_VAL_INIT(response);
+      return parseBody(*answer, &response);
+    }, [tally](bool accepted) {
+      if (accepted) {
+        ++tally->succeeded;
+      }
+
+      if (--tally->pending == 0) {
+        tally->result.set_value(tally->succeeded);
+      }
+    });
+  }
+
+  return result;
+}
+
+template<class Request> std::string DaemonPool::makeBody(const std::string& method, const Request& request) {
+  epee::json_rpc::request<Request> wrapper = AUTO_VAL_INIT(wrapper);
+  wrapper.jsonrpc = "2.0";
+  wrapper.id = std::string("0");
+  wrapper.method = method;
+  wrapper.params = request;
+  std::string body;
+  epee::serialization::store_t_to_json(wrapper, body);
+  return body;
+}
+
+template<class Request> std::string DaemonPool::makeBinaryBody(const Request& request) {
+  Request copy = request;
+  std::string body;
+  epee::serialization::store_t_to_binary(copy, body);
+  return body;
+}
+
+template<class Response> DaemonPool::Outcome DaemonPool::parseBody(boost::string_ref body, Response* response) {
+  epee::json_rpc::response<Response, epee::json_rpc::error> wrapper = AUTO_VAL_INIT(wrapper);
+  if (!epee::serialization::load_t_from_json(wrapper, body.data(), body.size())) {
+    return FAILED;
+  }
+
+  if (wrapper.error.code != 0 || !wrapper.error.message.empty()) {
+    return REJECTED;
+  }
+
+  if (!wrapper.result.status.empty() && wrapper.result.status != CORE_RPC_STATUS_OK) {
+    return REJECTED;
+  }
+
+  *response = std::move(wrapper.result);
+  return ACCEPTED;
+}
+
+template<class Response> DaemonPool::Outcome DaemonPool::parseBinaryBody(boost::string_ref body, Response* response) {
+  Response result = AUTO_VAL_INIT(result);
+  if (!epee::serialization::load_t_from_binary(result, body.data(), body.size())) {
+    return FAILED;
+  }
+
+  if (!result.status.empty() && result.status != CORE_RPC_STATUS_OK) {
+    return REJECTED;
+  }
+
+  *response = std::move(result);
+  return ACCEPTED;
+}
@@ -1,102 +1,102 @@
 #include "MergedMiner.h"
+#include <algorithm>
 #include <future>
+#include <memory>
+#include <new>
+#include <system_error>
+#include <thread>
+#include "DaemonPool.h"
+#include "Miner.h"
+#include "MiningJob.h"
+#include "RpcClient.h"
 #include <include_base_utils.h>
-#include "net/http_client.h"
-#include "storages/http_abstract_invoke.h"
+#include "crypto/scratchpad.h"
 #include "cryptonote_core/cryptonote_format_utils.h"
 #include "rpc/core_rpc_server_commands_defs.h"
+#include "serialization/binary_utils.h"
 
-class Miner {
-public:
-  Miner() : m_stopped(false) {
-  }
-
-  void start() {
-    m_stopped = false;
-  }
-
-  void stop() {
-    m_stopped = true;
-  }
-
-  bool findNonce(cryptonote::block* block, uint64_t height, cryptonote::difficulty_type difficulty, size_t threads, crypto::hash* hash) {
-    block->nonce = 0;
-    m_block = block;
-    m_difficulty = difficulty;
-    m_hashes = 0;
-    m_height = height;
-    m_nonce = 0;
-    m_nonceFound = false;
-    m_startedThreads = 1;
-    m_threads = threads;
-    uint8_t* long_state = new uint8_t[(1 << 21) * threads];
-
-    std::vector<std::future<crypto::hash>> futures;
-    for (size_t i = 1; i < threads; ++i) {
-      futures.emplace_back(std::async(std::launch::async, &Miner::threadProcedure, this, long_state + (1 << 21) * i));
-    }
+struct HashKernelChoice {
+  size_t kernel;
+  size_t ways;
+  double hashrate;
+};
 
-    *hash = findBlockNonce(*block, long_state);
-    for (std::future<crypto::hash>& future : futures) {
-      crypto::hash threadHash = future.get();
-      if (cryptonote::null_hash != threadHash) {
-        *hash = threadHash;
+const size_t TUNING_RUNS = 3;
+
+// Hashrate of threads threads hashing ways blobs at once with kernel, each on scratchpads of its own. The
+// threads allocate them before the clock starts, so that only the hashing is timed.
+static double measureHashrate(size_t kernel, crypto::cn_algorithm algorithm, size_t threads, size_t ways) {
+  const size_t BLOB_SIZE = 76;
+  std::atomic<size_t> ready(0);
+  std::atomic<bool> started(false);
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < threads; ++i) {
+    workers.push_back(std::thread([kernel, algorithm, ways, &ready, &started]() {
+      std::string blobs(BLOB_SIZE * ways, '\0');
+      crypto::scratchpad scratchpad(ways);
+      crypto::cn_hash_context context;
+      crypto::cn_hash_context_init(&context, scratchpad.data());
+      crypto::hash hashes[crypto::CN_MAX_WAYS];
+      ++ready;
+      while (!started) {
+        std::this_thread::yield();
       }
-    }
 
-    delete[] long_state;
-    block->nonce = m_nonce;
-    return m_nonceFound;
+      crypto::cn_slow_hash_kernel(kernel, &context, algorithm, ways, blobs.data(), BLOB_SIZE, reinterpret_cast<char*>(hashes));
+    }));
   }
 
-  uint64_t getHashCount() const {
-    return m_hashes;
+  while (ready != threads) {
+    std::this_thread::yield();
   }
 
-private:
-  cryptonote::block* m_block;
-  cryptonote::difficulty_type m_difficulty;
-  std::atomic<uint64_t> m_hashes;
-  uint64_t m_height;
-  std::atomic<uint32_t> m_nonce;
-  std::atomic<bool> m_nonceFound;
-  std::atomic<uint32_t> m_startedThreads;
-  std::atomic<bool> m_stopped;
-  size_t m_threads;
-
-  crypto::hash threadProcedure(uint8_t* long_state) {
-    cryptonote::block block = *m_block;
-    block.nonce = m_startedThreads++;
-    return findBlockNonce(block, long_state);
+  std::chrono::steady_clock::time_point time1 = std::chrono::steady_clock::now();
+  started = true;
+  for (std::thread& worker : workers) {
+    worker.join();
   }
 
-  crypto::hash findBlockNonce(cryptonote::block& block, uint8_t* long_state) {
-    crypto::hash blockHash = cryptonote::null_hash;
-    while (!m_nonceFound && !m_stopped) {
-      crypto::hash hash;
-      bool result = get_block_longhash(block, hash, m_height, long_state);
-      ++m_hashes;
-      if (!result) {
-        break;
+  std::chrono::steady_clock::time_point time2 = std::chrono::steady_clock::now();
+  return threads * ways / std::chrono::duration_cast<std::chrono::duration<double>>(time2 - time1).count();
+}
+
+// Measures every supported hash kernel and way count with as many threads as will mine, so that the way
+// count also accounts for their scratchpads sharing the caches, and selects the fastest kernel. Every
+// kernel is warmed up once and every way count is given the best of TUNING_RUNS runs, a single run
+// being too noisy to compare. The hashrate of the choice is that of all threads.
+static HashKernelChoice tuneHashKernel(crypto::cn_algorithm algorithm, size_t threads) {
+  HashKernelChoice choice = { crypto::cn_slow_hash_selected_kernel(), 1, 0 };
+  for (size_t kernel = 0; kernel < crypto::cn_slow_hash_kernel_count(); ++kernel) {
+    if (!crypto::cn_slow_hash_kernel_supported(kernel)) {
+      continue;
+    }
+
+    measureHashrate(kernel, algorithm, threads, 1);
+    double kernelHashrate = 0;
+    for (size_t ways = 1; ways <= crypto::CN_MAX_WAYS; ++ways) {
+      double hashrate = 0;
+      for (size_t run = 0; run < TUNING_RUNS; ++run) {
+        hashrate = std::max(hashrate, measureHashrate(kernel, algorithm, threads, ways));
       }
 
-      if (cryptonote::check_hash(hash, m_difficulty)) {
-        m_nonce = block.nonce;
-        m_nonceFound = true;
-        blockHash = hash;
-        break;
+      if (hashrate > choice.hashrate) {
+        choice.kernel = kernel;
+        choice.ways = ways;
+        choice.hashrate = hashrate;
       }
 
-      if (std::numeric_limits<uint32_t>::max() - block.nonce < m_threads) {
+      // Once the lanes saturate the cores more of them only add cache pressure
+      if (hashrate < kernelHashrate) {
         break;
       }
 
-      block.nonce += static_cast<uint32_t>(m_threads);
+      kernelHashrate = hashrate;
     }
-
-    return blockHash;
   }
-};
+
+  crypto::cn_slow_hash_select_kernel(choice.kernel);
+  return choice;
+}
 
 const size_t TX_EXTRA_FIELD_TAG_BYTES = 1;
 const size_t TX_MM_FIELD_SIZE_BYTES = 1;
@@ -104,27 +104,41 @@ const size_t MAX_VARINT_SIZE = 9;
 const size_t TX_MM_TAG_MAX_BYTES = MAX_VARINT_SIZE + sizeof(crypto::hash);
 const size_t MERGE_MINING_TAG_RESERVED_SIZE = TX_EXTRA_FIELD_TAG_BYTES  + TX_MM_FIELD_SIZE_BYTES + TX_MM_TAG_MAX_BYTES;
 
+// Least wait before asking again for templates, a daemon that is up but turns the request down, such as
+// one still syncing, is not backed off by its pool
+const std::chrono::milliseconds TEMPLATE_RETRY_DELAY(1000);
+
+// Compiled donor block together with the blocks and difficulties its solutions are submitted with
+struct MergedJob : MiningJob {
+  cryptonote::block block1;
+  cryptonote::block block2;
+  cryptonote::difficulty_type difficulty1;
+  cryptonote::difficulty_type difficulty2;
+};
+
 struct BlockTemplate {
   cryptonote::block block;
   uint64_t height;
   cryptonote::difficulty_type difficulty;
 };
 
-bool getBlockTemplate(epee::net_utils::http::http_simple_client* client, const std::string* address, const std::string* walletAddress, size_t extraNonceSize, BlockTemplate* blockTemplate) {
+// binary tells whether the blob of the response came in binary form or as hex
+static std::future<bool> requestBlockTemplate(DaemonPool& daemons, const std::string& walletAddress, size_t extraNonceSize, bool hedged, cryptonote::COMMAND_RPC_GETBLOCKTEMPLATE::response* response, bool* binary) {
   cryptonote::COMMAND_RPC_GETBLOCKTEMPLATE::request request;
   request.reserve_size = extraNonceSize;
-  request.wallet_address = *walletAddress;
-  cryptonote::COMMAND_RPC_GETBLOCKTEMPLATE::response response;
-  bool result = epee::net_utils::invoke_http_json_rpc(*address + "/json_rpc", "getblocktemplate", request, response, *client);
-  if (!result || (!response.status.empty() && response.status != CORE_RPC_STATUS_OK)) {
+  request.wallet_address = walletAddress;
+  return daemons.invoke<cryptonote::COMMAND_RPC_GETBLOCKTEMPLATE, cryptonote::COMMAND_RPC_GETBLOCKTEMPLATE_BIN>("getblocktemplate", request, CORE_RPC_GETBLOCKTEMPLATE_BIN_URI, request, hedged, response, binary);
+}
+
+static bool parseBlockTemplate(const cryptonote::COMMAND_RPC_GETBLOCKTEMPLATE::response& response, bool binary, BlockTemplate* blockTemplate) {
+  std::string blockString;
+  if (binary) {
+    blockString = response.blocktemplate_blob;
+  } else if (!epee::string_tools::parse_hexstr_to_binbuff(response.blocktemplate_blob, blockString)) {
     return false;
   }
 
-  std::string blockString;
-  epee::string_tools::parse_hexstr_to_binbuff(response.blocktemplate_blob, blockString);
-  std::istringstream stringStream(blockString);
-  binary_archive<false> archive(stringStream);
-  if (!serialization::serialize(archive, blockTemplate->block)) {
+  if (!serialization::parse_binary(blockString, blockTemplate->block)) {
     return false;
   }
 
@@ -133,6 +147,11 @@ bool getBlockTemplate(epee::net_utils::http::http_simple_client* client, const s
   return true;
 }
 
+static std::future<bool> requestLastBlockHeader(DaemonPool& daemons, cryptonote::COMMAND_RPC_GET_LAST_BLOCK_HEADER::response* response) {
+  cryptonote::COMMAND_RPC_GET_LAST_BLOCK_HEADER::request request;
+  return daemons.invoke<cryptonote::COMMAND_RPC_GET_LAST_BLOCK_HEADER>("getlastblockheader", request, false, response);
+}
+
 static bool fillExtra(cryptonote::block& block1, const cryptonote::block& block2) {
   std::vector<uint8_t>& extra = block1.miner_tx.extra;
   std::string extraAsString(reinterpret_cast<const char*>(extra.data()), extra.size());
@@ -172,7 +191,8 @@ static bool fillExtra(cryptonote::block& block1, const cryptonote::block& block2
   return true;
 }
 
-static bool mergeBlocks(const cryptonote::block& block1, cryptonote::block& block2) {
+// block1 is the one of job with the extra nonce and nonce of a solution, the job has its miner transaction branch already
+static bool mergeBlocks(const MiningJob& job, const cryptonote::block& block1, cryptonote::block& block2) {
   block2.timestamp = block1.timestamp;
   block2.parent_block.major_version = block1.major_version;
   block2.parent_block.minor_version = block1.minor_version;
@@ -180,28 +200,36 @@ static bool mergeBlocks(const cryptonote::block& block1, cryptonote::block& bloc
   block2.parent_block.nonce = block1.nonce;
   block2.parent_block.miner_tx = block1.miner_tx;
   block2.parent_block.number_of_transactions = block1.tx_hashes.size() + 1;
-  block2.parent_block.miner_tx_branch.resize(crypto::tree_depth(block1.tx_hashes.size() + 1));
-  std::vector<crypto::hash> transactionHashes;
-  transactionHashes.push_back(cryptonote::get_transaction_hash(block1.miner_tx));
-  std::copy(block1.tx_hashes.begin(), block1.tx_hashes.end(), std::back_inserter(transactionHashes));
-  tree_branch(transactionHashes.data(), transactionHashes.size(), block2.parent_block.miner_tx_branch.data());
+  block2.parent_block.miner_tx_branch = job.getMinerTxBranch();
   block2.parent_block.blockchain_branch.clear();
   return true;
 }
 
-static bool submitBlock(epee::net_utils::http::http_simple_client& client, const std::string& address, const cryptonote::block& block) {
+static std::future<size_t> submitBlock(DaemonPool& daemons, const cryptonote::block& block) {
+  cryptonote::COMMAND_RPC_SUBMITBLOCK_BIN::request binaryRequest;
+  binaryRequest.block_blob = t_serializable_object_to_blob(block);
   cryptonote::COMMAND_RPC_SUBMITBLOCK::request request;
-  request.push_back(epee::string_tools::buff_to_hex_nodelimer(t_serializable_object_to_blob(block)));
-  cryptonote::COMMAND_RPC_SUBMITBLOCK::response response;
-  bool result = epee::net_utils::invoke_http_json_rpc(address + "/json_rpc", "submitblock", request, response, client);
-  if (!result || (!response.status.empty() && response.status != CORE_RPC_STATUS_OK)) {
-    return false;
+  request.push_back(epee::string_tools::buff_to_hex_nodelimer(binaryRequest.block_blob));
+  return daemons.invokeAll<cryptonote::COMMAND_RPC_SUBMITBLOCK, cryptonote::COMMAND_RPC_SUBMITBLOCK_BIN>("submitblock", request, CORE_RPC_SUBMITBLOCK_BIN_URI, binaryRequest);
+}
+
+// Stops a helper thread of MergedMiner::mine on every way out of it, before the miner the thread may use goes away
+struct BackgroundThread {
+  BackgroundThread() : finished(false) {
   }
 
-  return true;
-}
+  ~BackgroundThread() {
+    finished = true;
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
 
-MergedMiner::MergedMiner() : m_blockCount(0), m_stopped(false) {
+  std::atomic<bool> finished;
+  std::thread thread;
+};
+
+MergedMiner::MergedMiner() : m_blockCount(0), m_stopped(false), m_algorithm(crypto::CN_ALGORITHM_CRYPTONIGHT), m_hashKernelTuned(false), m_tunedAlgorithm(crypto::CN_ALGORITHM_CRYPTONIGHT), m_tunedThreads(0), m_tunedWays(1), m_tipPollInterval(250), m_templateRefreshInterval(30000), m_hedgedRequests(false), m_binaryTransport(true), m_refreshRequested(false), m_tipChanged(false) {
 }
 
 uint32_t MergedMiner::getBlockCount() const {
@@ -219,21 +247,20 @@ std::string MergedMiner::getMessage() {
   return result;
 }
 
-bool MergedMiner::mine(std::string address1, std::string wallet1, std::string address2, std::string wallet2, size_t threads) {
-  epee::net_utils::http::http_simple_client httpClient1;
-  epee::net_utils::http::http_simple_client httpClient2;
-  Miner miner;
+bool MergedMiner::mine(std::vector<std::string> addresses1, std::string wallet1, std::vector<std::string> addresses2, std::string wallet2, size_t threads, size_t ways) {
+  RpcClient client;
+  DaemonPool daemons1(&client, addresses1);
+  DaemonPool daemons2(&client, addresses2);
+  daemons1.setBinaryTransport(m_binaryTransport);
+  daemons2.setBinaryTransport(m_binaryTransport);
   BlockTemplate blockTemplate1;
   BlockTemplate blockTemplate2;
-  cryptonote::block block1;
-  cryptonote::block block2;
-  cryptonote::difficulty_type difficulty1;
-  cryptonote::difficulty_type difficulty2;
-  std::future<bool> request1;
-  std::future<bool> request2;
-  std::future<bool> mining;
-  crypto::hash hash;
-  std::chrono::steady_clock::time_point time1;
+
+  if (m_algorithm != crypto::CN_ALGORITHM_CRYPTONIGHT && !daemons2.empty()) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_messages.push("Merged mining needs a donor network hashed with CryptoNight");
+    return false;
+  }
 
   uint64_t prefix1;
   cryptonote::account_public_address walletAddress1;
@@ -245,124 +272,308 @@ bool MergedMiner::mine(std::string address1, std::string wallet1, std::string ad
 
   uint64_t prefix2;
   cryptonote::account_public_address walletAddress2;
-  if (!address2.empty() && !get_account_address_from_str(prefix2, walletAddress2, wallet2)) {
+  if (!daemons2.empty() && !get_account_address_from_str(prefix2, walletAddress2, wallet2)) {
     std::lock_guard<std::mutex> lock(m_mutex);
     m_messages.push("Failed to parse acceptor wallet address");
     return false;
   }
 
-  m_blockCount = 0;
-  for (;;) {
-    miner.getHashCount();
+  // The fastest kernel and way count depend on the scratchpad size and on how many threads share the caches,
+  // so they are tuned again for another algorithm or thread count
+  if (!m_hashKernelTuned || m_tunedAlgorithm != m_algorithm || m_tunedThreads != threads) {
+    HashKernelChoice choice = tuneHashKernel(m_algorithm, threads);
+    m_tunedAlgorithm = m_algorithm;
+    m_tunedThreads = threads;
+    m_tunedWays = choice.ways;
+    m_hashKernelTuned = true;
+    std::ostringstream stream;
+    stream << "Hash kernel: " << crypto::cn_slow_hash_kernel_name(choice.kernel) << ", " << choice.ways << " hashes per thread, " << choice.hashrate / threads << " H/s per thread";
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_messages.push(stream.str());
+  }
 
-    if (m_stopped) {
-      if (mining.valid()) {
-        miner.stop();
-        mining.wait();
-      }
+  if (ways == 0) {
+    ways = m_tunedWays;
+  }
 
-      return true;
+  {
+    std::lock_guard<std::mutex> lock(m_refreshMutex);
+    m_refreshRequested = false;
+    m_tipChanged = false;
+  }
+
+  // Workers keep hashing the previous job while the next one is fetched and switch to it on their own,
+  // solutions go straight from them to the submission thread. Templates are fetched again as soon as
+  // the watcher sees a new chain tip or a solution is found, and otherwise every m_templateRefreshInterval.
+  // While no daemon of a chain answers, mining goes on with the last job and fetching backs off.
+  std::unique_ptr<Miner> miner;
+  try {
+    miner.reset(new Miner(threads, ways));
+  } catch (std::bad_alloc&) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_messages.push("Failed to allocate scratchpads");
+    return false;
+  } catch (std::system_error&) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_messages.push("Failed to start mining threads");
+    return false;
+  }
+
+  BackgroundThread submission;
+  submission.thread = std::thread(&MergedMiner::submitSolutions, this, miner.get(), &daemons1, &daemons2, &submission.finished);
+  BackgroundThread watcher;
+  watcher.thread = std::thread(&MergedMiner::watchChainTips, this, &daemons1, &daemons2, &watcher.finished);
+  uint64_t hashCount = 0;
+  std::chrono::steady_clock::time_point time1 = std::chrono::steady_clock::now();
+  bool tipChanged = false;
+  std::chrono::steady_clock::time_point tipChangeTime;
+  uint64_t tipChanges = 0;
+  std::chrono::duration<double> tipLatencySum(0);
+  std::chrono::duration<double> tipLatencyMax(0);
+  bool extraNonceMissing = false;
+
+  // Sleeps until a refresh is due and takes over the earliest pending chain tip change
+  auto waitForRefresh = [&](std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(m_refreshMutex);
+    m_refreshCondition.wait_for(lock, timeout, [this] { return m_refreshRequested || m_stopped; });
+    if (m_tipChanged && !tipChanged) {
+      tipChanged = true;
+      tipChangeTime = m_tipChangeTime;
     }
 
-    request1 = std::async(std::launch::async, getBlockTemplate, &httpClient1, &address1, &wallet1, MERGE_MINING_TAG_RESERVED_SIZE, &blockTemplate1);
-    if (!address2.empty()) {
-      request2 = std::async(std::launch::async, getBlockTemplate, &httpClient2, &address2, &wallet2, MERGE_MINING_TAG_RESERVED_SIZE, &blockTemplate2);
+    m_refreshRequested = false;
+    m_tipChanged = false;
+  };
+
+  m_blockCount = 0;
+  for (;;) {
+    if (m_stopped) {
+      return true;
     }
 
-    if (!request1.get()) {
-      std::lock_guard<std::mutex> lock(m_mutex);
-      m_messages.push("Failed to get donor block");
-      continue;
+    // Both chains are asked at once, the answers come in on the event loop of the client
+    cryptonote::COMMAND_RPC_GETBLOCKTEMPLATE::response response1;
+    cryptonote::COMMAND_RPC_GETBLOCKTEMPLATE::response response2;
+    bool binary1;
+    bool binary2;
+    std::future<bool> request1 = requestBlockTemplate(daemons1, wallet1, MERGE_MINING_TAG_RESERVED_SIZE, m_hedgedRequests, &response1, &binary1);
+    std::future<bool> request2;
+    if (!daemons2.empty()) {
+      request2 = requestBlockTemplate(daemons2, wallet2, MERGE_MINING_TAG_RESERVED_SIZE, m_hedgedRequests, &response2, &binary2);
     }
 
-    if (!address2.empty()) {
-      if (!request2.get()) {
+    bool result1 = request1.get() && parseBlockTemplate(response1, binary1, &blockTemplate1);
+    bool result2 = daemons2.empty() || (request2.get() && parseBlockTemplate(response2, binary2, &blockTemplate2));
+    if (!result1 || !result2) {
+      {
         std::lock_guard<std::mutex> lock(m_mutex);
-        m_messages.push("Failed to get acceptor block");
-        continue;
+        if (!result1) {
+          m_messages.push("Failed to get donor block (" + daemons1.getStatus() + ")");
+        }
+
+        if (!result2) {
+          m_messages.push("Failed to get acceptor block (" + daemons2.getStatus() + ")");
+        }
       }
 
+      waitForRefresh(std::max(TEMPLATE_RETRY_DELAY, std::max(result1 ? std::chrono::milliseconds(0) : daemons1.getRetryDelay(), result2 ? std::chrono::milliseconds(0) : daemons2.getRetryDelay())));
+      continue;
+    }
+
+    if (!daemons2.empty()) {
       if (blockTemplate2.block.major_version != BLOCK_MAJOR_VERSION_2) {
         std::lock_guard<std::mutex> lock(m_mutex);
         m_messages.push("Unsupported block version received from acceptor network, merged mining is not possible");
-        if (mining.valid()) {
-          miner.stop();
-          mining.wait();
-        }
-
         return false;
       }
     }
 
-    if (mining.valid()) {
-      miner.stop();
-      if (mining.get()) {
-        if (cryptonote::check_hash(hash, difficulty1)) {
-          if (submitBlock(httpClient1, address1, block1)) {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            m_messages.push("Submitted donor block");
-          } else {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            m_messages.push("Failed to submit donor block");
-          }
-        }
+    if (blockTemplate1.block.major_version != BLOCK_MAJOR_VERSION_1) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_messages.push("Unsupported block version received from donor network");
+      return false;
+    }
 
-        if (!address2.empty() && cryptonote::check_hash(hash, difficulty2)) {
-          if (!mergeBlocks(block1, block2)) {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            m_messages.push("Internal error");
-            return false;
-          }
-
-          if (submitBlock(httpClient2, address2, block2)) {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            m_messages.push("Submitted acceptor block");
-          } else {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            m_messages.push("Failed to submit acceptor block");
-          }
-        }
+    std::shared_ptr<MergedJob> job = std::make_shared<MergedJob>();
+    job->block1 = blockTemplate1.block;
+    job->difficulty1 = blockTemplate1.difficulty;
+    cryptonote::difficulty_type difficulty = job->difficulty1;
+    if (!daemons2.empty()) {
+      job->block2 = blockTemplate2.block;
+      job->difficulty2 = blockTemplate2.difficulty;
+      difficulty = std::min(difficulty, job->difficulty2);
+      if (!fillExtra(job->block1, job->block2)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_messages.push("Internal error");
+        return false;
       }
+    }
 
-      std::chrono::steady_clock::time_point time2 = std::chrono::steady_clock::now();
+    if (!job->compile(job->block1, blockTemplate1.height, difficulty, job->difficulty1, m_algorithm)) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_messages.push("Internal error");
+      return false;
+    }
+
+    // Told once, the daemon keeps sending templates without the reserved area
+    if (job->getMaxExtraNonce() == 0 && !extraNonceMissing) {
+      extraNonceMissing = true;
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_messages.push("No extra nonce reserved in donor block, only the 32-bit nonce is rolled");
+    }
+
+    miner->setJob(job);
+    if (tipChanged) {
+      std::chrono::duration<double> latency = std::chrono::steady_clock::now() - tipChangeTime;
+      ++tipChanges;
+      tipLatencySum += latency;
+      tipLatencyMax = std::max(tipLatencyMax, latency);
       std::ostringstream stream;
-      stream << "Hashrate: " << miner.getHashCount() / std::chrono::duration_cast<std::chrono::duration<double>>(time2 - time1).count();
+      stream << "New work " << static_cast<uint64_t>(latency.count() * 1000) << " ms after chain tip change, average " << static_cast<uint64_t>(tipLatencySum.count() * 1000 / tipChanges) << " ms, maximum " << static_cast<uint64_t>(tipLatencyMax.count() * 1000) << " ms";
       std::lock_guard<std::mutex> lock(m_mutex);
       m_messages.push(stream.str());
-      time1 = time2;
+      tipChanged = false;
+    }
+
+    waitForRefresh(m_templateRefreshInterval);
 
-      miner.start();
-    } else {
-      time1 = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point time2 = std::chrono::steady_clock::now();
+    uint64_t hashCount2 = miner->getHashCount();
+    std::ostringstream stream;
+    stream << "Hashrate: " << (hashCount2 - hashCount) / std::chrono::duration_cast<std::chrono::duration<double>>(time2 - time1).count();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_messages.push(stream.str());
+    hashCount = hashCount2;
+    time1 = time2;
+  }
+}
+
+// Takes solutions from the miner as soon as they are found and posts them to every daemon of both chains at once
+void MergedMiner::submitSolutions(Miner* miner, DaemonPool* daemons1, DaemonPool* daemons2, std::atomic<bool>* finished) {
+  while (!*finished) {
+    Miner::Solution solution;
+    if (!miner->waitForSolution(std::chrono::milliseconds(100), &solution)) {
+      continue;
+    }
+
+    // A solved template is spent
+    requestRefresh(false);
+    const MergedJob& job = static_cast<const MergedJob&>(*solution.job);
+    cryptonote::block block1 = job.block1;
+    job.setExtraNonce(block1.miner_tx, solution.extraNonce);
+    block1.nonce = solution.nonce;
+    bool submit1 = cryptonote::check_hash(solution.hash, job.difficulty1);
+    bool submit2 = !daemons2->empty() && cryptonote::check_hash(solution.hash, job.difficulty2);
+    cryptonote::block block2;
+    std::future<size_t> request1;
+    std::future<size_t> request2;
+    if (submit1) {
+      request1 = submitBlock(*daemons1, block1);
     }
 
-    block1 = blockTemplate1.block;
-    difficulty1 = blockTemplate1.difficulty;
-    cryptonote::difficulty_type difficulty = difficulty1;
-    if (!address2.empty()) {
-      block2 = blockTemplate2.block;
-      difficulty2 = blockTemplate2.difficulty;
-      difficulty = std::min(difficulty, difficulty2);
-      if (!fillExtra(block1, block2)) {
+    if (submit2) {
+      block2 = job.block2;
+      if (!mergeBlocks(job, block1, block2)) {
         std::lock_guard<std::mutex> lock(m_mutex);
         m_messages.push("Internal error");
-        return false;
+        submit2 = false;
+      } else {
+        request2 = submitBlock(*daemons2, block2);
       }
     }
 
-    mining = std::async(std::launch::async, &Miner::findNonce, &miner, &block1, blockTemplate1.height, difficulty, threads, &hash);
-    for (size_t i = 0; i < 50; ++i) {
-      if (m_stopped || mining.wait_for(std::chrono::milliseconds(100)) == std::future_status::ready) {
-        break;
+    if (submit1) {
+      if (request1.get() != 0) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_messages.push("Submitted donor block");
+      } else {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_messages.push("Failed to submit donor block");
+      }
+    }
+
+    if (submit2) {
+      if (request2.get() != 0) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_messages.push("Submitted acceptor block");
+      } else {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_messages.push("Failed to submit acceptor block");
       }
     }
   }
 }
 
+// Polls the cheap last block header call of both chains and requests new templates when a tip moves
+void MergedMiner::watchChainTips(DaemonPool* daemons1, DaemonPool* daemons2, std::atomic<bool>* finished) {
+  std::string tip1;
+  std::string tip2;
+  while (!*finished) {
+    cryptonote::COMMAND_RPC_GET_LAST_BLOCK_HEADER::response response1;
+    cryptonote::COMMAND_RPC_GET_LAST_BLOCK_HEADER::response response2;
+    std::future<bool> request1 = requestLastBlockHeader(*daemons1, &response1);
+    std::future<bool> request2;
+    if (!daemons2->empty()) {
+      request2 = requestLastBlockHeader(*daemons2, &response2);
+    }
+
+    if (request1.get() && response1.block_header.hash != tip1) {
+      if (!tip1.empty()) {
+        requestRefresh(true);
+      }
+
+      tip1 = response1.block_header.hash;
+    }
+
+    if (!daemons2->empty() && request2.get() && response2.block_header.hash != tip2) {
+      if (!tip2.empty()) {
+        requestRefresh(true);
+      }
+
+      tip2 = response2.block_header.hash;
+    }
+
+    std::this_thread::sleep_for(m_tipPollInterval);
+  }
+}
+
+void MergedMiner::requestRefresh(bool tipChanged) {
+  std::lock_guard<std::mutex> lock(m_refreshMutex);
+  m_refreshRequested = true;
+  if (tipChanged && !m_tipChanged) {
+    m_tipChanged = true;
+    m_tipChangeTime = std::chrono::steady_clock::now();
+  }
+
+  m_refreshCondition.notify_all();
+}
+
 void MergedMiner::start() {
   m_stopped = false;
 }
 
 void MergedMiner::stop() {
+  std::lock_guard<std::mutex> lock(m_refreshMutex);
   m_stopped = true;
+  m_refreshCondition.notify_all();
+}
+
+void MergedMiner::setTipPollInterval(std::chrono::milliseconds interval) {
+  m_tipPollInterval = interval;
+}
+
+void MergedMiner::setTemplateRefreshInterval(std::chrono::milliseconds interval) {
+  m_templateRefreshInterval = interval;
+}
+
+void MergedMiner::setHedgedRequests(bool hedged) {
+  m_hedgedRequests = hedged;
+}
+
+void MergedMiner::setBinaryTransport(bool enabled) {
+  m_binaryTransport = enabled;
+}
+
+void MergedMiner::setAlgorithm(crypto::cn_algorithm algorithm) {
+  m_algorithm = algorithm;
 }
@@ -1,22 +1,58 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
 #include <queue>
 #include <string>
+#include <vector>
+#include "crypto/hash.h"
+
+class DaemonPool;
+class Miner;
 
 class MergedMiner {
 public:
   MergedMiner();
   uint32_t getBlockCount() const;
   std::string getMessage();
-  bool mine(std::string address1, std::string wallet1, std::string address2, std::string wallet2, size_t threads);
+  // Every chain is served by a list of daemon addresses, an empty acceptor list mines the donor chain alone
+  bool mine(std::vector<std::string> addresses1, std::string wallet1, std::vector<std::string> addresses2, std::string wallet2, size_t threads, size_t ways);
   void start();
   void stop();
+  void setTipPollInterval(std::chrono::milliseconds interval);
+  void setTemplateRefreshInterval(std::chrono::milliseconds interval);
+  // Fetches templates from the two fastest healthy daemons of a chain at once and takes the first answer
+  void setHedgedRequests(bool hedged);
+  // Asks for templates and submits blocks in portable storage binary form, daemons that do not serve
+  // it get JSON-RPC. On by default.
+  void setBinaryTransport(bool enabled);
+  // Proof of work of the donor chain, CryptoNight by default. Acceptor chains are only merged
+  // into a CryptoNight donor.
+  void setAlgorithm(crypto::cn_algorithm algorithm);
 
 private:
   std::atomic<uint32_t> m_blockCount;
   std::atomic<bool> m_stopped;
   std::queue<std::string> m_messages;
   std::mutex m_mutex;
+  crypto::cn_algorithm m_algorithm;
+  bool m_hashKernelTuned;
+  crypto::cn_algorithm m_tunedAlgorithm;
+  size_t m_tunedThreads;
+  size_t m_tunedWays;
+  std::chrono::milliseconds m_tipPollInterval;
+  std::chrono::milliseconds m_templateRefreshInterval;
+  bool m_hedgedRequests;
+  bool m_binaryTransport;
+  std::mutex m_refreshMutex;
+  std::condition_variable m_refreshCondition;
+  bool m_refreshRequested;
+  bool m_tipChanged;
+  std::chrono::steady_clock::time_point m_tipChangeTime;
+
+  void requestRefresh(bool tipChanged);
+  void submitSolutions(Miner* miner, DaemonPool* daemons1, DaemonPool* daemons2, std::atomic<bool>* finished);
+  void watchChainTips(DaemonPool* daemons1, DaemonPool* daemons2, std::atomic<bool>* finished);
 };
@@ -0,0 +1,214 @@
+#include "Miner.h"
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <new>
+#include "MiningJob.h"
+#include "crypto/scratchpad.h"
+#include "cryptonote_core/cryptonote_format_utils.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+static void pinCurrentThread(size_t index) {
+  size_t cpuCount = std::thread::hardware_concurrency();
+  if (cpuCount == 0) {
+    return;
+  }
+
+#if defined(_WIN32)
+  size_t maskBits = sizeof(DWORD_PTR) * 8;
+  size_t cpu = index % (cpuCount < maskBits ? cpuCount : maskBits);
+  SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu);
+#elif defined(__linux__)
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(index % cpuCount, &cpus);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+}
+
+Miner::Miner(size_t threads, size_t ways) : m_hashCounters(threads), m_epoch(0), m_readyWorkers(0), m_failed(false), m_shutdown(false), m_ways(ways) {
+  // Workers already started have to be joined before the exception leaves, or their threads terminate the process
+  try {
+    for (size_t i = 0; i < threads; ++i) {
+      m_workers.emplace_back(&Miner::workerProcedure, this, i);
+    }
+  } catch (...) {
+    shutdown();
+    throw;
+  }
+
+  bool failed;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_readyCondition.wait(lock, [this] { return m_readyWorkers == m_hashCounters.size(); });
+    failed = m_failed;
+  }
+
+  if (failed) {
+    shutdown();
+    throw std::bad_alloc();
+  }
+}
+
+Miner::~Miner() {
+  shutdown();
+}
+
+void Miner::setJob(const std::shared_ptr<const MiningJob>& job) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_jobState = std::make_shared<JobState>(job);
+  // Queued solutions are all of the replaced job, their template is out of date
+  m_solutions = std::queue<Solution>();
+  ++m_epoch;
+  m_jobCondition.notify_all();
+}
+
+bool Miner::waitForSolution(std::chrono::milliseconds timeout, Solution* solution) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (!m_solutionCondition.wait_for(lock, timeout, [this] { return !m_solutions.empty(); })) {
+    return false;
+  }
+
+  *solution = m_solutions.front();
+  m_solutions.pop();
+  return true;
+}
+
+uint64_t Miner::getHashCount() const {
+  uint64_t hashes = 0;
+  for (const HashCounter& counter : m_hashCounters) {
+    hashes += counter.hashes.load(std::memory_order_relaxed);
+  }
+
+  return hashes;
+}
+
+void Miner::shutdown() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_shutdown = true;
+    ++m_epoch;
+    m_jobCondition.notify_all();
+  }
+
+  for (std::thread& worker : m_workers) {
+    worker.join();
+  }
+
+  m_workers.clear();
+}
+
+void Miner::workerProcedure(size_t index) {
+  // Pin before touching the scratchpad so that its pages land on the node of this CPU
+  pinCurrentThread(index);
+
+  std::unique_ptr<crypto::scratchpad> scratchpad;
+  try {
+    scratchpad.reset(new crypto::scratchpad(m_ways));
+  } catch (std::bad_alloc&) {
+  }
+
+  crypto::cn_hash_context context;
+  if (scratchpad) {
+    crypto::cn_hash_context_init(&context, scratchpad->data());
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_failed = m_failed || !scratchpad;
+    ++m_readyWorkers;
+    m_readyCondition.notify_all();
+  }
+
+  HashCounter& counter = m_hashCounters[index];
+  std::shared_ptr<JobState> jobState;
+  const MiningJob* job = nullptr;
+  uint64_t epoch = 0;
+  bool idle = true;
+  std::string jobBlob;
+  std::string blobs;
+  size_t blobSize = 0;
+  uint64_t extraNonce = 0;
+  uint64_t nonce = 0;
+  uint64_t leaseEnd = 0;
+  uint64_t leaseSize = NONCE_LEASE_BATCHES * m_ways;
+  uint64_t nonceLimit = static_cast<uint64_t>(std::numeric_limits<uint32_t>::max()) + 1;
+  uint64_t leasesPerExtraNonce = (nonceLimit + leaseSize - 1) / leaseSize;
+  crypto::hash hashes[crypto::CN_MAX_WAYS];
+  for (;;) {
+    // Every iteration hashes m_ways consecutive nonces, one per blob copy
+    if (idle || m_epoch.load(std::memory_order_relaxed) != epoch) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_jobCondition.wait(lock, [this, epoch] { return m_epoch != epoch; });
+      if (m_shutdown) {
+        return;
+      }
+
+      jobState = m_jobState;
+      job = jobState->job.get();
+      epoch = m_epoch;
+      idle = false;
+      lock.unlock();
+
+      blobs.clear();
+      nonce = leaseEnd = 0;
+    }
+
+    // The block of a spent job is found, the rest of its nonces are worthless
+    if (jobState->spent.load(std::memory_order_relaxed)) {
+      idle = true;
+      continue;
+    }
+
+    if (nonce == leaseEnd) {
+      uint64_t lease = jobState->nextLease.fetch_add(1);
+      uint64_t leaseExtraNonce = lease / leasesPerExtraNonce;
+      if (leaseExtraNonce > job->getMaxExtraNonce()) {
+        idle = true;
+        continue;
+      }
+
+      nonce = lease % leasesPerExtraNonce * leaseSize;
+      leaseEnd = std::min(nonce + leaseSize, nonceLimit);
+      if (blobs.empty() || leaseExtraNonce != extraNonce) {
+        extraNonce = leaseExtraNonce;
+        job->makeBlob(extraNonce, &jobBlob);
+        blobSize = jobBlob.size();
+        blobs.clear();
+        for (size_t i = 0; i < m_ways; ++i) {
+          blobs += jobBlob;
+        }
+      }
+    }
+
+    // The last lease of the nonce space may end inside a batch, its missing lanes repeat the last nonce
+    size_t lanes = static_cast<size_t>(std::min<uint64_t>(m_ways, leaseEnd - nonce));
+    for (size_t i = 0; i < m_ways; ++i) {
+      job->setNonce(&blobs[blobSize * i], static_cast<uint32_t>(nonce + std::min(i, lanes - 1)));
+    }
+
+    crypto::cn_slow_hash_multi(context, job->getAlgorithm(), m_ways, blobs.data(), blobSize, hashes);
+    counter.hashes.store(counter.hashes.load(std::memory_order_relaxed) + lanes, std::memory_order_relaxed);
+    for (size_t i = 0; i < lanes; ++i) {
+      if (cryptonote::check_hash(hashes[i], job->getDifficulty())) {
+        Solution solution = { jobState->job, extraNonce, static_cast<uint32_t>(nonce + i), hashes[i] };
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (jobState != m_jobState || jobState->spent) {
+          break;
+        }
+
+        jobState->spent = cryptonote::check_hash(hashes[i], job->getBlockDifficulty());
+        m_solutions.push(solution);
+        m_solutionCondition.notify_all();
+      }
+    }
+
+    nonce += lanes;
+  }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#include "crypto/hash.h"
+
+class MiningJob;
+
+// Pool of mining threads living as long as the miner. Every worker is pinned to
+// a CPU and keeps its scratchpad for its whole life. A job published by setJob
+// replaces the previous one at the next hash boundary of every worker, workers
+// only idle before the first job and after exhausting the nonces of a job.
+// Workers lease nonces of a job in ranges of NONCE_LEASE_BATCHES * ways, so the
+// whole 32-bit nonce space gets hashed exactly once whatever the thread count.
+// Leases past the nonce space move on to the next extra nonce of the job.
+// A solution at the block difficulty of the job spends it, workers stop hashing
+// it and wait for the next one. Solutions of a replaced or spent job are dropped.
+class Miner {
+public:
+  struct Solution {
+    std::shared_ptr<const MiningJob> job;
+    uint64_t extraNonce;
+    uint32_t nonce;
+    crypto::hash hash;
+  };
+
+  static const size_t NONCE_LEASE_BATCHES = 32;
+
+  // Throws std::bad_alloc when a scratchpad can't be allocated and std::system_error when a thread can't be started
+  Miner(size_t threads, size_t ways);
+  ~Miner();
+  void setJob(const std::shared_ptr<const MiningJob>& job);
+  bool waitForSolution(std::chrono::milliseconds timeout, Solution* solution);
+  uint64_t getHashCount() const;
+
+private:
+  static const size_t CACHE_LINE_SIZE = 64;
+
+  // Written by its worker only, one cache line apart from the next so that
+  // counting hashes does not bounce lines between cores
+  struct HashCounter {
+    HashCounter() : hashes(0) {
+    }
+
+    std::atomic<uint64_t> hashes;
+    char padding[CACHE_LINE_SIZE - sizeof(std::atomic<uint64_t>)];
+  };
+
+  struct JobState {
+    explicit JobState(const std::shared_ptr<const MiningJob>& job) : job(job), nextLease(0), spent(false) {
+    }
+
+    std::shared_ptr<const MiningJob> job;
+    std::atomic<uint64_t> nextLease;
+    // Set under the mutex by the worker finding a solution at the block difficulty
+    std::atomic<bool> spent;
+  };
+
+  std::vector<std::thread> m_workers;
+  std::mutex m_mutex;
+  std::condition_variable m_jobCondition;
+  std::condition_variable m_readyCondition;
+  std::condition_variable m_solutionCondition;
+  std::vector<HashCounter> m_hashCounters;
+  std::shared_ptr<JobState> m_jobState;
+  std::atomic<uint64_t> m_epoch;
+  std::queue<Solution> m_solutions;
+  size_t m_readyWorkers;
+  bool m_failed;
+  bool m_shutdown;
+  size_t m_ways;
+
+  void shutdown();
+  void workerProcedure(size_t index);
+};
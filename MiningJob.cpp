@@ -0,0 +1,180 @@
+#include "MiningJob.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include "common/int-util.h"
+#include "cryptonote_core/cryptonote_format_utils.h"
+
+MiningJob::MiningJob() : m_nonceOffset(0), m_merkleRootOffset(0), m_extraNonceOffset(0), m_extraNonceBlobOffset(0), m_extraNonceSize(0), m_minerTxHash(cryptonote::null_hash), m_merkleRoot(cryptonote::null_hash), m_height(0), m_difficulty(0), m_blockDifficulty(0), m_algorithm(crypto::CN_ALGORITHM_CRYPTONIGHT) {
+}
+
+// Locates the data of the extra nonce field, the area getblocktemplate reserves for the miner
+static bool findExtraNonce(const std::vector<uint8_t>& extra, size_t* offset, size_t* size) {
+  size_t i = 0;
+  while (i < extra.size()) {
+    if (extra[i] == TX_EXTRA_TAG_PADDING) {
+      // Padding is a run of zero bytes, each of them reads as a tag of its own
+      ++i;
+    } else if (extra[i] == TX_EXTRA_TAG_PUBKEY) {
+      i += 1 + sizeof(crypto::public_key);
+    } else if (extra[i] == TX_EXTRA_NONCE) {
+      if (i + 1 >= extra.size() || extra.size() - i - 2 < extra[i + 1]) {
+        return false;
+      }
+
+      *offset = i + 2;
+      *size = extra[i + 1];
+      return true;
+    } else if (extra[i] == TX_EXTRA_MERGE_MINING_TAG) {
+      size_t fieldSize;
+      int read = tools::read_varint(extra.begin() + i + 1, extra.end(), fieldSize);
+      if (read <= 0 || fieldSize > extra.size() - i - 1 - read) {
+        return false;
+      }
+
+      i += 1 + read + fieldSize;
+    } else {
+      return false;
+    }
+  }
+
+  return false;
+}
+
+bool MiningJob::compile(const cryptonote::block& block, uint64_t height, cryptonote::difficulty_type difficulty, cryptonote::difficulty_type blockDifficulty, crypto::cn_algorithm algorithm) {
+  // Only the version 1 header carries the nonce in the hashing blob, as its last field
+  if (block.major_version != BLOCK_MAJOR_VERSION_1) {
+    return false;
+  }
+
+  cryptonote::blobdata blob;
+  if (!cryptonote::t_serializable_object_to_blob(static_cast<const cryptonote::block_header&>(block), blob)) {
+    return false;
+  }
+
+  if (blob.size() < sizeof(uint32_t)) {
+    return false;
+  }
+
+  size_t nonceOffset = blob.size() - sizeof(uint32_t);
+  uint32_t nonce;
+  memcpy(&nonce, blob.data() + nonceOffset, sizeof(nonce));
+  if (swap32le(nonce) != block.nonce) {
+    return false;
+  }
+
+  // Without an extra nonce field only the 32-bit nonce can be rolled
+  size_t extraNonceOffset = 0;
+  size_t extraNonceSize = 0;
+  findExtraNonce(block.miner_tx.extra, &extraNonceOffset, &extraNonceSize);
+
+  cryptonote::blobdata minerTxBlob;
+  if (!cryptonote::t_serializable_object_to_blob(block.miner_tx, minerTxBlob)) {
+    return false;
+  }
+
+  const std::vector<uint8_t>& extra = block.miner_tx.extra;
+  size_t extraBlobOffset = minerTxBlob.rfind(std::string(extra.begin(), extra.end()));
+  if (std::string::npos == extraBlobOffset) {
+    return false;
+  }
+
+  // The rolled bytes start from extra nonce 0, so that the blob below is the one of extra nonce 0
+  extraNonceSize = std::min<size_t>(extraNonceSize, sizeof(uint64_t));
+  size_t extraNonceBlobOffset = extraBlobOffset + extraNonceOffset;
+  std::fill(minerTxBlob.begin() + extraNonceBlobOffset, minerTxBlob.begin() + extraNonceBlobOffset + extraNonceSize, '\0');
+
+  crypto::hash minerTxHash = cryptonote::get_blob_hash(minerTxBlob);
+  std::vector<crypto::hash> transactionHashes;
+  transactionHashes.reserve(block.tx_hashes.size() + 1);
+  transactionHashes.push_back(minerTxHash);
+  transactionHashes.insert(transactionHashes.end(), block.tx_hashes.begin(), block.tx_hashes.end());
+  // The branch does not depend on the miner transaction, it is all a new extra nonce needs to get the root
+  std::vector<crypto::hash> minerTxBranch(crypto::tree_depth(transactionHashes.size()));
+  crypto::tree_branch(transactionHashes.data(), transactionHashes.size(), minerTxBranch.data());
+  crypto::hash merkleRoot;
+  crypto::tree_hash_from_branch(minerTxBranch.data(), minerTxBranch.size(), minerTxHash, nullptr, merkleRoot);
+
+  size_t merkleRootOffset = blob.size();
+  blob.append(reinterpret_cast<const char*>(&merkleRoot), sizeof(merkleRoot));
+  blob.append(tools::get_varint_data(transactionHashes.size()));
+
+  m_blob.swap(blob);
+  m_nonceOffset = nonceOffset;
+  m_merkleRootOffset = merkleRootOffset;
+  m_minerTxBlob.swap(minerTxBlob);
+  m_extraNonceOffset = extraNonceOffset;
+  m_extraNonceBlobOffset = extraNonceBlobOffset;
+  m_extraNonceSize = extraNonceSize;
+  m_minerTxBranch.swap(minerTxBranch);
+  m_minerTxHash = minerTxHash;
+  m_merkleRoot = merkleRoot;
+  m_height = height;
+  m_difficulty = difficulty;
+  m_blockDifficulty = blockDifficulty;
+  m_algorithm = algorithm;
+  return true;
+}
+
+const std::string& MiningJob::getBlob() const {
+  return m_blob;
+}
+
+size_t MiningJob::getNonceOffset() const {
+  return m_nonceOffset;
+}
+
+const crypto::hash& MiningJob::getMinerTxHash() const {
+  return m_minerTxHash;
+}
+
+const crypto::hash& MiningJob::getMerkleRoot() const {
+  return m_merkleRoot;
+}
+
+const std::vector<crypto::hash>& MiningJob::getMinerTxBranch() const {
+  return m_minerTxBranch;
+}
+
+uint64_t MiningJob::getHeight() const {
+  return m_height;
+}
+
+cryptonote::difficulty_type MiningJob::getDifficulty() const {
+  return m_difficulty;
+}
+
+cryptonote::difficulty_type MiningJob::getBlockDifficulty() const {
+  return m_blockDifficulty;
+}
+
+crypto::cn_algorithm MiningJob::getAlgorithm() const {
+  return m_algorithm;
+}
+
+void MiningJob::setNonce(char* blob, uint32_t nonce) const {
+  nonce = swap32le(nonce);
+  memcpy(blob + m_nonceOffset, &nonce, sizeof(nonce));
+}
+
+uint64_t MiningJob::getMaxExtraNonce() const {
+  return m_extraNonceSize == sizeof(uint64_t) ? std::numeric_limits<uint64_t>::max() : (static_cast<uint64_t>(1) << (8 * m_extraNonceSize)) - 1;
+}
+
+void MiningJob::makeBlob(uint64_t extraNonce, std::string* blob) const {
+  std::string minerTxBlob = m_minerTxBlob;
+  for (size_t i = 0; i < m_extraNonceSize; ++i) {
+    minerTxBlob[m_extraNonceBlobOffset + i] = static_cast<char>(extraNonce >> (8 * i));
+  }
+
+  crypto::hash merkleRoot;
+  crypto::tree_hash_from_branch(m_minerTxBranch.data(), m_minerTxBranch.size(), cryptonote::get_blob_hash(minerTxBlob), nullptr, merkleRoot);
+  *blob = m_blob;
+  memcpy(&(*blob)[m_merkleRootOffset], &merkleRoot, sizeof(merkleRoot));
+}
+
+void MiningJob::setExtraNonce(cryptonote::transaction& minerTx, uint64_t extraNonce) const {
+  for (size_t i = 0; i < m_extraNonceSize; ++i) {
+    minerTx.extra[m_extraNonceOffset + i] = static_cast<uint8_t>(extraNonce >> (8 * i));
+  }
+}
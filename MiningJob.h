@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "crypto/hash.h"
+#include "cryptonote_core/cryptonote_basic.h"
+#include "cryptonote_core/difficulty.h"
+
+// Hashing blob of a block template, built once per template. Workers copy the
+// blob and only patch the nonce bytes in place before every hash. Once the nonces
+// run out a worker rolls an extra nonce, written into the extra nonce field of the
+// miner transaction, and rebuilds its copy with makeBlob.
+class MiningJob {
+public:
+  MiningJob();
+  // algorithm is the proof of work of the chain, the one the blobs are hashed with. Hashes meeting difficulty
+  // are solutions, one meeting blockDifficulty makes the block of the template and spends it.
+  bool compile(const cryptonote::block& block, uint64_t height, cryptonote::difficulty_type difficulty, cryptonote::difficulty_type blockDifficulty, crypto::cn_algorithm algorithm);
+  const std::string& getBlob() const;
+  size_t getNonceOffset() const;
+  const crypto::hash& getMinerTxHash() const;
+  const crypto::hash& getMerkleRoot() const;
+  // Sibling path of the miner transaction in the transaction tree, the same for every extra nonce
+  const std::vector<crypto::hash>& getMinerTxBranch() const;
+  uint64_t getHeight() const;
+  cryptonote::difficulty_type getDifficulty() const;
+  cryptonote::difficulty_type getBlockDifficulty() const;
+  crypto::cn_algorithm getAlgorithm() const;
+  void setNonce(char* blob, uint32_t nonce) const;
+  uint64_t getMaxExtraNonce() const;
+  void makeBlob(uint64_t extraNonce, std::string* blob) const;
+  void setExtraNonce(cryptonote::transaction& minerTx, uint64_t extraNonce) const;
+
+private:
+  std::string m_blob;
+  size_t m_nonceOffset;
+  size_t m_merkleRootOffset;
+  std::string m_minerTxBlob;
+  size_t m_extraNonceOffset;
+  size_t m_extraNonceBlobOffset;
+  size_t m_extraNonceSize;
+  std::vector<crypto::hash> m_minerTxBranch;
+  crypto::hash m_minerTxHash;
+  crypto::hash m_merkleRoot;
+  uint64_t m_height;
+  cryptonote::difficulty_type m_difficulty;
+  cryptonote::difficulty_type m_blockDifficulty;
+  crypto::cn_algorithm m_algorithm;
+};
@@ -0,0 +1,288 @@
+#include "RpcClient.h"
+#include <deque>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/write.hpp>
+#include "net/http_response_parser.h"
+
+const size_t RECEIVE_BUFFER_SIZE = 16384;
+
+class RpcClient::Connection : public std::enable_shared_from_this<Connection> {
+public:
+  Connection(boost::asio::io_service& ioService, const std::string& address) : m_ioService(ioService), m_resolver(ioService), m_socket(ioService), m_state(DISCONNECTED), m_generation(0), m_writing(false) {
+    std::string hostPort = boost::algorithm::starts_with(address, "http://") ? address.substr(7) : address;
+    size_t colon = hostPort.rfind(':');
+    m_host = hostPort.substr(0, colon);
+    m_port = colon == std::string::npos ? "80" : hostPort.substr(colon + 1);
+  }
+
+  void enqueue(const std::string& uri, const std::string& contentType, const std::string& body, std::chrono::milliseconds timeout, const Callback& callback) {
+    std::shared_ptr<Call> call = std::make_shared<Call>(m_ioService, callback);
+    call->request = "POST " + uri + " HTTP/1.1\r\nHost: " + m_host + "\r\nContent-Type: " + contentType + "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: keep-alive\r\n\r\n" + body;
+    call->deadline.expires_from_now(timeout);
+    std::shared_ptr<Connection> self = shared_from_this();
+    call->deadline.async_wait([self, call](const boost::system::error_code& error) {
+      if (!error) {
+        self->expire(call);
+      }
+    });
+
+    m_queued.push_back(call);
+    if (m_state == DISCONNECTED) {
+      connect();
+    } else if (m_state == CONNECTED) {
+      write();
+    }
+  }
+
+  void close() {
+    reset();
+    fail(m_queued);
+  }
+
+private:
+  enum State {
+    DISCONNECTED,
+    CONNECTING,
+    CONNECTED
+  };
+
+  struct Call {
+    Call(boost::asio::io_service& ioService, const Callback& callback) : callback(callback), deadline(ioService), finished(false) {
+    }
+
+    std::string request;
+    Callback callback;
+    boost::asio::steady_timer deadline;
+    bool finished;
+  };
+
+  boost::asio::io_service& m_ioService;
+  boost::asio::ip::tcp::resolver m_resolver;
+  boost::asio::ip::tcp::socket m_socket;
+  std::string m_host;
+  std::string m_port;
+  State m_state;
+  // Handlers of a socket that has been closed since they were started find a newer generation and back off
+  uint64_t m_generation;
+  // Waiting for the connection or for the write in progress
+  std::deque<std::shared_ptr<Call>> m_queued;
+  // Written, their responses come in this order
+  std::deque<std::shared_ptr<Call>> m_inFlight;
+  std::string m_writeBuffer;
+  bool m_writing;
+  // Responses are received into the buffer of the parser and handed out from there
+  epee::net_utils::http::http_response_parser m_parser;
+
+  static void finish(const std::shared_ptr<Call>& call, unsigned int status, boost::string_ref body) {
+    if (call->finished) {
+      return;
+    }
+
+    call->finished = true;
+    call->deadline.cancel();
+    call->callback(status, body);
+  }
+
+  static void fail(std::deque<std::shared_ptr<Call>>& calls) {
+    std::deque<std::shared_ptr<Call>> failed;
+    failed.swap(calls);
+    for (const std::shared_ptr<Call>& call : failed) {
+      finish(call, NO_RESPONSE, boost::string_ref());
+    }
+  }
+
+  void connect() {
+    m_state = CONNECTING;
+    uint64_t generation = m_generation;
+    std::shared_ptr<Connection> self = shared_from_this();
+    m_resolver.async_resolve(boost::asio::ip::tcp::resolver::query(m_host, m_port), [self, generation](const boost::system::error_code& error, boost::asio::ip::tcp::resolver::iterator endpoints) {
+      if (generation != self->m_generation) {
+        return;
+      }
+
+      if (error) {
+        self->reset();
+        fail(self->m_queued);
+        return;
+      }
+
+      boost::asio::async_connect(self->m_socket, endpoints, [self, generation](const boost::system::error_code& error, boost::asio::ip::tcp::resolver::iterator) {
+        if (generation != self->m_generation) {
+          return;
+        }
+
+        if (error) {
+          self->reset();
+          fail(self->m_queued);
+          return;
+        }
+
+        boost::system::error_code ignored;
+        self->m_socket.set_option(boost::asio::ip::tcp::no_delay(true), ignored);
+        self->m_state = CONNECTED;
+        self->read();
+        self->write();
+      });
+    });
+  }
+
+  // Sends everything queued in one write, behind the requests still waiting for their responses
+  void write() {
+    if (m_writing || m_queued.empty()) {
+      return;
+    }
+
+    m_writeBuffer.clear();
+    for (const std::shared_ptr<Call>& call : m_queued) {
+      m_writeBuffer += call->request;
+      m_inFlight.push_back(call);
+    }
+
+    m_queued.clear();
+    m_writing = true;
+    uint64_t generation = m_generation;
+    std::shared_ptr<Connection> self = shared_from_this();
+    boost::asio::async_write(m_socket, boost::asio::buffer(m_writeBuffer), [self, generation](const boost::system::error_code& error, size_t) {
+      if (generation != self->m_generation) {
+        return;
+      }
+
+      self->m_writing = false;
+      if (error) {
+        self->reconnect();
+        return;
+      }
+
+      self->write();
+    });
+  }
+
+  void read() {
+    uint64_t generation = m_generation;
+    std::shared_ptr<Connection> self = shared_from_this();
+    m_socket.async_read_some(boost::asio::buffer(m_parser.prepare(RECEIVE_BUFFER_SIZE), RECEIVE_BUFFER_SIZE), [self, generation](const boost::system::error_code& error, size_t size) {
+      if (generation != self->m_generation) {
+        return;
+      }
+
+      if (error) {
+        // A body without a length ends with the connection, it is handed out like any response without keep-alive
+        if (error == boost::asio::error::eof && self->m_parser.finish() == epee::net_utils::http::http_response_parser::parse_done) {
+          self->handleResponses();
+        } else {
+          self->reconnect();
+        }
+
+        return;
+      }
+
+      self->m_parser.commit(size);
+      if (self->handleResponses()) {
+        self->read();
+      }
+    });
+  }
+
+  // Returns false when the connection had to be closed
+  bool handleResponses() {
+    for (;;) {
+      epee::net_utils::http::http_response_parser::parse_result result = m_parser.parse();
+      if (result == epee::net_utils::http::http_response_parser::parse_more) {
+        return true;
+      }
+
+      if (result == epee::net_utils::http::http_response_parser::parse_error || m_inFlight.empty()) {
+        reconnect();
+        return false;
+      }
+
+      std::shared_ptr<Call> call = m_inFlight.front();
+      m_inFlight.pop_front();
+      bool keepAlive = m_parser.is_keep_alive();
+      finish(call, static_cast<unsigned int>(m_parser.get_response_code()), m_parser.get_body());
+      m_parser.consume();
+      if (!keepAlive) {
+        reconnect();
+        return false;
+      }
+    }
+  }
+
+  void expire(const std::shared_ptr<Call>& call) {
+    if (call->finished) {
+      return;
+    }
+
+    for (std::deque<std::shared_ptr<Call>>::iterator i = m_queued.begin(); i != m_queued.end(); ++i) {
+      if (*i == call) {
+        m_queued.erase(i);
+        finish(call, NO_RESPONSE, boost::string_ref());
+        return;
+      }
+    }
+
+    // An overdue response holds up the ones pipelined behind it, they all go with the connection
+    reconnect();
+  }
+
+  void reset() {
+    ++m_generation;
+    boost::system::error_code ignored;
+    m_resolver.cancel();
+    m_socket.close(ignored);
+    m_state = DISCONNECTED;
+    m_writing = false;
+    m_parser.reset();
+    fail(m_inFlight);
+  }
+
+  // Requests not written yet go out on a new connection
+  void reconnect() {
+    reset();
+    if (!m_queued.empty()) {
+      connect();
+    }
+  }
+};
+
+RpcClient::RpcClient() : m_work(new boost::asio::io_service::work(m_ioService)) {
+  m_thread = std::thread([this] { m_ioService.run(); });
+}
+
+RpcClient::~RpcClient() {
+  m_ioService.post([this] {
+    for (std::map<std::string, std::shared_ptr<Connection>>::value_type& connection : m_connections) {
+      connection.second->close();
+    }
+
+    m_connections.clear();
+  });
+
+  m_work.reset();
+  m_thread.join();
+}
+
+void RpcClient::post(const std::string& address, const std::string& uri, const std::string& contentType, const std::string& body, std::chrono::milliseconds timeout, const Callback& callback) {
+  m_ioService.post([this, address, uri, contentType, body, timeout, callback] {
+    std::shared_ptr<Connection>& connection = m_connections[address];
+    if (!connection) {
+      connection = std::make_shared<Connection>(m_ioService, address);
+    }
+
+    connection->enqueue(uri, contentType, body, timeout, callback);
+  });
+}
+
+std::future<RpcClient::Response> RpcClient::post(const std::string& address, const std::string& uri, const std::string& contentType, const std::string& body, std::chrono::milliseconds timeout) {
+  std::shared_ptr<std::promise<Response>> promise = std::make_shared<std::promise<Response>>();
+  std::future<Response> response = promise->get_future();
+  post(address, uri, contentType, body, timeout, [promise](unsigned int status, boost::string_ref body) {
+    Response response = { status, body.to_string() };
+    promise->set_value(response);
+  });
+
+  return response;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <boost/asio/io_service.hpp>
+#include <boost/utility/string_ref.hpp>
+
+// HTTP client running the requests to all daemons on one event loop thread. Every address
+// gets one keep-alive connection, opened on its first request and reopened after a failure
+// without blocking anybody. Requests to the same address are pipelined on that connection
+// and answered in order, every request fails on its own deadline.
+class RpcClient {
+public:
+  // Status code of the response, NO_RESPONSE when the request failed before one arrived
+  static const unsigned int NO_RESPONSE = 0;
+
+  struct Response {
+    unsigned int status;
+    std::string body;
+  };
+
+  // Called on the event loop thread, must not block. body points into the receive buffer
+  // of the connection and is valid during the call only.
+  typedef std::function<void(unsigned int status, boost::string_ref body)> Callback;
+
+  RpcClient();
+  ~RpcClient();
+  void post(const std::string& address, const std::string& uri, const std::string& contentType, const std::string& body, std::chrono::milliseconds timeout, const Callback& callback);
+  std::future<Response> post(const std::string& address, const std::string& uri, const std::string& contentType, const std::string& body, std::chrono::milliseconds timeout);
+
+private:
+  class Connection;
+
+  boost::asio::io_service m_ioService;
+  std::unique_ptr<boost::asio::io_service::work> m_work;
+  // Touched on the event loop thread only
+  std::map<std::string, std::shared_ptr<Connection>> m_connections;
+  std::thread m_thread;
+};
@@ -4,11 +4,19 @@
 
 #pragma once
 
+#include <cstring>
 #include <limits>
 #include <type_traits>
 #include <utility>
-#include <sstream>
 #include <string>
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "common/int-util.h"
 
 namespace tools {
 
@@ -22,12 +30,97 @@ namespace tools {
         *dest++ = static_cast<char>(i);
     }
 
+    // Largest encoding of a 64-bit value, and the room write_varint_span needs at dest
+    const size_t VARINT_MAX_SIZE = 10;
+
+    namespace detail {
+        // Index of the lowest set bit of x, which is not zero
+        inline unsigned varint_low_bit(uint64_t x) {
+#if defined(_MSC_VER) && defined(_M_X64)
+            unsigned long index;
+            _BitScanForward64(&index, x);
+            return index;
+#elif defined(_MSC_VER)
+            unsigned long index;
+            if (_BitScanForward(&index, static_cast<uint32_t>(x))) {
+                return index;
+            }
+            _BitScanForward(&index, static_cast<uint32_t>(x >> 32));
+            return index + 32;
+#else
+            return __builtin_ctzll(x);
+#endif
+        }
+
+        // Index of the highest set bit of x, which is not zero
+        inline unsigned varint_high_bit(uint64_t x) {
+#if defined(_MSC_VER) && defined(_M_X64)
+            unsigned long index;
+            _BitScanReverse64(&index, x);
+            return index;
+#elif defined(_MSC_VER)
+            unsigned long index;
+            if (_BitScanReverse(&index, static_cast<uint32_t>(x >> 32))) {
+                return index + 32;
+            }
+            _BitScanReverse(&index, static_cast<uint32_t>(x));
+            return index;
+#else
+            return 63 - __builtin_clzll(x);
+#endif
+        }
+
+        // Packs the low 7 bits of every byte of x into the low 56 bits
+        inline uint64_t varint_gather(uint64_t x) {
+#if defined(__BMI2__)
+            return _pext_u64(x, 0x7f7f7f7f7f7f7f7full);
+#else
+            x &= 0x7f7f7f7f7f7f7f7full;
+            x = ((x & 0x7f007f007f007f00ull) >> 1) | (x & 0x007f007f007f007full);
+            x = ((x & 0x3fff00003fff0000ull) >> 2) | (x & 0x00003fff00003fffull);
+            return ((x & 0x0fffffff00000000ull) >> 4) | (x & 0x000000000fffffffull);
+#endif
+        }
+
+        // Spreads the low 56 bits of x over the low 7 bits of every byte, the inverse of varint_gather
+        inline uint64_t varint_scatter(uint64_t x) {
+#if defined(__BMI2__)
+            return _pdep_u64(x, 0x7f7f7f7f7f7f7f7full);
+#else
+            x = ((x & 0x00fffffff0000000ull) << 4) | (x & 0x000000000fffffffull);
+            x = ((x & 0x0fffc0000fffc000ull) << 2) | (x & 0x00003fff00003fffull);
+            return ((x & 0x3f803f803f803f80ull) << 1) | (x & 0x007f007f007f007full);
+#endif
+        }
+    }
+
+    // write_varint for a contiguous buffer with room for VARINT_MAX_SIZE bytes, returns the size
+    // written. Values below 2^56, which is all of them but keys and extreme amounts, are spread
+    // out at once and stored with one 8-byte write.
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value, size_t>::type
+    write_varint_span(uint8_t *dest, T i) {
+        uint64_t value = i;
+        if (value >> 56 != 0) {
+            uint8_t *end = dest;
+            write_varint(end, value);
+            return end - dest;
+        }
+
+        uint64_t spread = detail::varint_scatter(value);
+        size_t size = detail::varint_high_bit(spread | 1) / 8 + 1;
+        // Every byte but the last one has the continuation bit
+        spread |= 0x8080808080808080ull & ((static_cast<uint64_t>(1) << (8 * (size - 1))) - 1);
+        spread = SWAP64LE(spread);
+        memcpy(dest, &spread, sizeof(spread));
+        return size;
+    }
+
     template<typename t_type>
     std::string get_varint_data(const t_type& v)
     {
-      std::stringstream ss;
-      write_varint(std::ostreambuf_iterator<char>(ss), v);
-      return ss.str();
+      uint8_t buf[VARINT_MAX_SIZE];
+      return std::string(reinterpret_cast<const char*>(buf), write_varint_span(buf, v));
     }
 
     template<int bits, typename InputIt, typename T>
@@ -59,4 +152,36 @@ namespace tools {
     int read_varint(InputIt &&first, InputIt &&last, T &i) {
         return read_varint<std::numeric_limits<T>::digits, InputIt, T>(std::move(first), std::move(last), i);
     }
+
+    // read_varint for a contiguous buffer, first is moved past what was read. With 8 bytes left
+    // a varint of up to 8 bytes is decoded from one load: the first byte without the continuation
+    // bit gives its size and the 7-bit groups are gathered at once. Longer ones, those that could
+    // overflow T and invalid ones go through read_varint, which reports them the same way.
+    template<int bits, typename T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value && 0 <= bits && bits <= std::numeric_limits<T>::digits, int>::type
+    read_varint_span(const uint8_t *&first, const uint8_t *last, T &i) {
+        if (last - first >= 8) {
+            uint64_t word;
+            memcpy(&word, first, sizeof(word));
+            word = SWAP64LE(word);
+            uint64_t stops = ~word & 0x8080808080808080ull;
+            if (stops != 0) {
+                int size = detail::varint_low_bit(stops) / 8 + 1;
+                // A last byte of zero is non-canonical, unless it is the only one
+                if (7 * size <= bits && (size == 1 || (word >> (8 * (size - 1)) & 0xff) != 0)) {
+                    uint64_t mask = size == 8 ? ~static_cast<uint64_t>(0) : (static_cast<uint64_t>(1) << (8 * size)) - 1;
+                    i = static_cast<T>(detail::varint_gather(word & mask));
+                    first += size;
+                    return size;
+                }
+            }
+        }
+
+        return read_varint<bits>(first, last, i);
+    }
+
+    template<typename T>
+    int read_varint_span(const uint8_t *&first, const uint8_t *last, T &i) {
+        return read_varint_span<std::numeric_limits<T>::digits>(first, last, i);
+    }
 }
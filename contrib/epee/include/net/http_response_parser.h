@@ -0,0 +1,454 @@
+
+// Copyright (c) 2006-2013, Andrey N. Sabelnikov, www.sabelnikov.net
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Andrey N. Sabelnikov nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER  BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <boost/utility/string_ref.hpp>
+
+namespace epee
+{
+  namespace net_utils
+  {
+    namespace http
+    {
+      /************************************************************************/
+      /* Incremental HTTP/1.1 response parser over one reusable buffer.       */
+      /* Data is received straight into the space handed out by prepare(),    */
+      /* every byte is looked at once and the header and body stay where they */
+      /* arrived, they are handed out as views valid until the next prepare() */
+      /* or consume(). Chunked bodies are joined in place as their chunks     */
+      /* come in, so their payload is moved at most once.                     */
+      /************************************************************************/
+      class http_response_parser
+      {
+      public:
+        enum parse_result
+        {
+          parse_more,
+          parse_done,
+          parse_error
+        };
+
+        http_response_parser()
+        {
+          reset();
+        }
+
+        //at least size writable bytes after the received ones
+        char* prepare(size_t size)
+        {
+          if(m_buffer.size() - m_begin - m_size < size && m_begin)
+          {
+            //the response in progress moves to the front, behind it the space of the consumed ones
+            memmove(&m_buffer[0], &m_buffer[m_begin], m_size);
+            m_begin = 0;
+          }
+
+          if(m_buffer.size() - m_begin - m_size < size)
+            m_buffer.resize(std::max(m_buffer.size() * 2, m_begin + m_size + size));
+
+          return &m_buffer[m_begin + m_size];
+        }
+
+        void commit(size_t size)
+        {
+          m_size += size;
+        }
+
+        //parses what has been received so far
+        parse_result parse()
+        {
+          for(;;)
+          {
+            switch(m_state)
+            {
+            case state_status_line:
+            case state_header:
+            case state_chunk_head:
+            case state_chunk_body_end:
+            case state_chunk_trailer:
+              {
+                size_t line_end;
+                if(!next_line(line_end))
+                  return m_state == state_error ? parse_error : parse_more;
+
+                handle_line(m_scan, line_end);
+                m_scan = line_end + 1;
+              }
+              break;
+            case state_body_content_len:
+              if(m_size - m_body_begin < m_remain)
+                return parse_more;
+
+              m_body_end = m_body_begin + m_remain;
+              m_message_end = m_body_end;
+              m_state = state_done;
+              break;
+            case state_body_connection_close:
+              return parse_more;
+            case state_chunk_body:
+              {
+                size_t available = std::min(m_size - m_scan, m_remain);
+                if(m_body_end != m_scan)
+                  memmove(data() + m_body_end, data() + m_scan, available);
+
+                m_body_end += available;
+                m_scan += available;
+                m_remain -= available;
+                if(m_remain)
+                  return parse_more;
+
+                m_state = state_chunk_body_end;
+              }
+              break;
+            case state_done:
+              return parse_done;
+            case state_error:
+            default:
+              return parse_error;
+            }
+          }
+        }
+
+        //the connection has been closed, ends a body delimited by the close
+        parse_result finish()
+        {
+          if(m_state == state_body_connection_close)
+          {
+            m_body_end = m_size;
+            m_message_end = m_size;
+            m_state = state_done;
+          }
+
+          return m_state == state_done ? parse_done : parse_error;
+        }
+
+        //drops the parsed response, data received past its end starts the next one
+        void consume()
+        {
+          m_begin += m_message_end;
+          m_size -= m_message_end;
+          if(!m_size)
+            m_begin = 0;
+
+          start_response();
+        }
+
+        void reset()
+        {
+          m_begin = 0;
+          m_size = 0;
+          start_response();
+        }
+
+        int get_response_code() const { return m_response_code; }
+        int get_http_ver_hi() const { return m_http_ver_hi; }
+        int get_http_ver_lo() const { return m_http_ver_lo; }
+
+        //the server keeps the connection open after this response
+        bool is_keep_alive() const
+        {
+          boost::string_ref connection = get_field("Connection");
+          if(m_http_ver_hi == 1 && m_http_ver_lo == 0)
+            return equal_no_case(connection, "keep-alive");
+
+          return !equal_no_case(connection, "close");
+        }
+
+        //value of the first header field of the name, empty when there is none
+        boost::string_ref get_field(const char* name) const
+        {
+          for(const field& f: m_fields)
+          {
+            if(equal_no_case(boost::string_ref(data() + f.m_name, f.m_name_size), name))
+              return boost::string_ref(data() + f.m_value, f.m_value_size);
+          }
+
+          return boost::string_ref();
+        }
+
+        template<class t_callback>
+        void for_each_field(t_callback callback) const
+        {
+          for(const field& f: m_fields)
+            callback(boost::string_ref(data() + f.m_name, f.m_name_size), boost::string_ref(data() + f.m_value, f.m_value_size));
+        }
+
+        boost::string_ref get_body() const
+        {
+          return boost::string_ref(data() + m_body_begin, m_body_end - m_body_begin);
+        }
+
+      private:
+        enum parse_state
+        {
+          state_status_line,
+          state_header,
+          state_body_content_len,
+          state_body_connection_close,
+          state_chunk_head,
+          state_chunk_body,
+          state_chunk_body_end,
+          state_chunk_trailer,
+          state_done,
+          state_error
+        };
+
+        //offsets from the start of the response
+        struct field
+        {
+          size_t m_name;
+          size_t m_name_size;
+          size_t m_value;
+          size_t m_value_size;
+        };
+
+        static const size_t max_line_size = 16384;
+
+        std::string m_buffer;
+        size_t m_begin;
+        size_t m_size;
+        parse_state m_state;
+        size_t m_scan;
+        size_t m_remain;
+        size_t m_body_begin;
+        size_t m_body_end;
+        size_t m_message_end;
+        int m_response_code;
+        int m_http_ver_hi;
+        int m_http_ver_lo;
+        std::vector<field> m_fields;
+
+        char* data() { return &m_buffer[0] + m_begin; }
+        const char* data() const { return m_buffer.data() + m_begin; }
+
+        static bool equal_no_case(boost::string_ref value, const char* expected)
+        {
+          size_t size = strlen(expected);
+          if(value.size() != size)
+            return false;
+
+          for(size_t i = 0; i != size; i++)
+          {
+            if(tolower(static_cast<unsigned char>(value[i])) != tolower(static_cast<unsigned char>(expected[i])))
+              return false;
+          }
+
+          return true;
+        }
+
+        static boost::string_ref trim(boost::string_ref value)
+        {
+          while(!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+            value.remove_prefix(1);
+          while(!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+            value.remove_suffix(1);
+          return value;
+        }
+
+        static bool parse_decimal(boost::string_ref value, size_t& result)
+        {
+          value = trim(value);
+          result = 0;
+          if(value.empty())
+            return false;
+
+          for(char ch: value)
+          {
+            if(ch < '0' || ch > '9' || result > (static_cast<size_t>(-1) - 9) / 10)
+              return false;
+            result = result * 10 + (ch - '0');
+          }
+
+          return true;
+        }
+
+        static bool parse_hex(boost::string_ref value, size_t& result)
+        {
+          //chunk extensions after ';' are ignored
+          size_t extension = value.find(';');
+          if(extension != boost::string_ref::npos)
+            value = value.substr(0, extension);
+
+          value = trim(value);
+          result = 0;
+          if(value.empty())
+            return false;
+
+          for(char ch: value)
+          {
+            int digit;
+            if(ch >= '0' && ch <= '9')
+              digit = ch - '0';
+            else if(ch >= 'a' && ch <= 'f')
+              digit = ch - 'a' + 10;
+            else if(ch >= 'A' && ch <= 'F')
+              digit = ch - 'A' + 10;
+            else
+              return false;
+
+            if(result > (static_cast<size_t>(-1) >> 4))
+              return false;
+            result = result << 4 | digit;
+          }
+
+          return true;
+        }
+
+        void start_response()
+        {
+          m_state = state_status_line;
+          m_scan = 0;
+          m_remain = 0;
+          m_body_begin = 0;
+          m_body_end = 0;
+          m_message_end = 0;
+          m_response_code = 0;
+          m_http_ver_hi = 0;
+          m_http_ver_lo = 0;
+          m_fields.clear();
+        }
+
+        //finds the '\n' ending the line at m_scan
+        bool next_line(size_t& line_end)
+        {
+          const void* found = memchr(data() + m_scan, '\n', m_size - m_scan);
+          if(!found)
+          {
+            if(m_size - m_scan > max_line_size)
+              m_state = state_error;
+            return false;
+          }
+
+          line_end = static_cast<const char*>(found) - data();
+          return true;
+        }
+
+        void handle_line(size_t line_begin, size_t line_end)
+        {
+          if(line_end > line_begin && data()[line_end - 1] == '\r')
+            line_end--;
+
+          boost::string_ref line(data() + line_begin, line_end - line_begin);
+          switch(m_state)
+          {
+          case state_status_line:
+            {
+              //"HTTP/1.1 200 OK"
+              if(line.size() < 12 || line.substr(0, 5) != boost::string_ref("HTTP/") || !isdigit(line[5]) || line[6] != '.' || !isdigit(line[7]) || line[8] != ' ')
+              {
+                m_state = state_error;
+                return;
+              }
+
+              size_t code;
+              if(!parse_decimal(line.substr(9, 3), code))
+              {
+                m_state = state_error;
+                return;
+              }
+
+              m_http_ver_hi = line[5] - '0';
+              m_http_ver_lo = line[7] - '0';
+              m_response_code = static_cast<int>(code);
+              m_state = state_header;
+            }
+            break;
+          case state_header:
+            if(line.empty())
+            {
+              start_body(line_end + (data()[line_end] == '\r' ? 2 : 1));
+              return;
+            }
+
+            {
+              size_t colon = line.find(':');
+              if(colon == boost::string_ref::npos)
+              {
+                m_state = state_error;
+                return;
+              }
+
+              boost::string_ref name = trim(line.substr(0, colon));
+              boost::string_ref value = trim(line.substr(colon + 1));
+              field f = { static_cast<size_t>(name.data() - data()), name.size(), static_cast<size_t>(value.data() - data()), value.size() };
+              m_fields.push_back(f);
+            }
+            break;
+          case state_chunk_head:
+            if(line.empty())
+              break;
+
+            if(!parse_hex(line, m_remain))
+            {
+              m_state = state_error;
+              return;
+            }
+
+            m_state = m_remain ? state_chunk_body : state_chunk_trailer;
+            break;
+          case state_chunk_body_end:
+            m_state = line.empty() ? state_chunk_head : state_error;
+            break;
+          case state_chunk_trailer:
+            if(line.empty())
+            {
+              m_message_end = line_end + (data()[line_end] == '\r' ? 2 : 1);
+              m_state = state_done;
+            }
+            break;
+          default:
+            m_state = state_error;
+          }
+        }
+
+        void start_body(size_t body_begin)
+        {
+          //parse() goes on at the line after the current one, which is the body start
+          m_body_begin = body_begin;
+          m_body_end = body_begin;
+          m_message_end = body_begin;
+          boost::string_ref transfer_encoding = get_field("Transfer-Encoding");
+          boost::string_ref content_length = get_field("Content-Length");
+          if((m_response_code >= 100 && m_response_code < 200) || m_response_code == 204 || m_response_code == 304)
+            m_state = state_done;
+          else if(!transfer_encoding.empty())
+            m_state = equal_no_case(transfer_encoding, "chunked") ? state_chunk_head : state_error;
+          else if(!content_length.empty())
+            m_state = parse_decimal(content_length, m_remain) ? state_body_content_len : state_error;
+          else if(!is_keep_alive())
+            m_state = state_body_connection_close;
+          else
+            m_state = state_error;
+        }
+      };
+    }
+  }
+}
@@ -348,6 +348,19 @@ namespace net_utils
 
 		inline 
 		bool recv(std::string& buff)
+		{
+			char local_buff[10000];
+			size_t bytes_transfered = 0;
+			if(!recv(local_buff, sizeof(local_buff), bytes_transfered))
+				return false;
+
+			buff.assign(local_buff, bytes_transfered);
+			return true;
+		}
+
+		//receives straight into buff, bytes_transfered stays zero when the connection has been closed
+		inline 
+		bool recv(void* buff, size_t buff_size, size_t& bytes_transfered)
 		{
 
 			try
@@ -370,13 +383,11 @@ namespace net_utils
 				// can use boost::bind rather than boost::lambda.
 
 				boost::system::error_code ec = boost::asio::error::would_block;
-				size_t bytes_transfered = 0;
+				bytes_transfered = 0;
 			
 				handler_obj hndlr(ec, bytes_transfered);
 
-				char local_buff[10000] = {0};
-				//m_socket.async_read_some(boost::asio::buffer(local_buff, sizeof(local_buff)), hndlr);
-				boost::asio::async_read(m_socket, boost::asio::buffer(local_buff, sizeof(local_buff)), boost::asio::transfer_at_least(1), hndlr);
+				boost::asio::async_read(m_socket, boost::asio::buffer(buff, buff_size), boost::asio::transfer_at_least(1), hndlr);
 
 				// Block until the asynchronous operation has completed.
 				while (ec == boost::asio::error::would_block && !boost::interprocess::ipcdetail::atomic_read32(&m_shutdowned))
@@ -404,10 +415,6 @@ namespace net_utils
 					m_deadline.expires_at(boost::posix_time::pos_infin);
 				}
 
-				/*if(!bytes_transfered)
-					return false;*/
-
-				buff.assign(local_buff, bytes_transfered);
 				return true;
 			}
 
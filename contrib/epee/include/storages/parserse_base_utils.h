@@ -81,11 +81,12 @@ namespace misc_utils
       \\  Backslash character
 
       */
-      inline void match_string2(std::string::const_iterator& star_end_string, std::string::const_iterator buf_end, std::string& val)
+      template<class t_iterator>
+      inline void match_string2(t_iterator& star_end_string, t_iterator buf_end, std::string& val)
       {
         val.clear();
         bool escape_mode = false;
-        std::string::const_iterator it = star_end_string;
+        t_iterator it = star_end_string;
         ++it;
         for(;it != buf_end;it++)
         {
@@ -133,7 +134,8 @@ namespace misc_utils
         }
         ASSERT_MES_AND_THROW("Failed to match string in json entry: " << std::string(star_end_string, buf_end));
       }
-      inline bool match_string(std::string::const_iterator& star_end_string, std::string::const_iterator buf_end, std::string& val)
+      template<class t_iterator>
+      inline bool match_string(t_iterator& star_end_string, t_iterator buf_end, std::string& val)
       {
         try
         {
@@ -146,11 +148,12 @@ namespace misc_utils
           return false;
         }
       }
-      inline void match_number2(std::string::const_iterator& star_end_string, std::string::const_iterator buf_end, std::string& val, bool& is_float_val, bool& is_signed_val)
+      template<class t_iterator>
+      inline void match_number2(t_iterator& star_end_string, t_iterator buf_end, std::string& val, bool& is_float_val, bool& is_signed_val)
       {
         val.clear();
         is_float_val = false;
-        for(std::string::const_iterator it = star_end_string;it != buf_end;it++)
+        for(t_iterator it = star_end_string;it != buf_end;it++)
         {
           if(isdigit(*it) || (it == star_end_string && *it == '-') || (val.size() && *it == '.' ) || (is_float_val && (*it == 'e' || *it == 'E' || *it == '-' || *it == '+' )) )
           {
@@ -173,7 +176,8 @@ namespace misc_utils
         }
         ASSERT_MES_AND_THROW("wrong number in json entry: " << std::string(star_end_string, buf_end));
       }
-      inline bool match_number(std::string::const_iterator& star_end_string, std::string::const_iterator buf_end, std::string& val)
+      template<class t_iterator>
+      inline bool match_number(t_iterator& star_end_string, t_iterator buf_end, std::string& val)
       {
         try
         {
@@ -186,11 +190,12 @@ namespace misc_utils
           return false;
         }
       }
-      inline void match_word2(std::string::const_iterator& star_end_string, std::string::const_iterator buf_end, std::string& val)
+      template<class t_iterator>
+      inline void match_word2(t_iterator& star_end_string, t_iterator buf_end, std::string& val)
       {
         val.clear();
 
-        for(std::string::const_iterator it = star_end_string;it != buf_end;it++)
+        for(t_iterator it = star_end_string;it != buf_end;it++)
         {
           if(!isalpha(*it))
           {
@@ -205,7 +210,8 @@ namespace misc_utils
         }
         ASSERT_MES_AND_THROW("failed to match word number in json entry: " << std::string(star_end_string, buf_end));
       }
-      inline bool match_word(std::string::const_iterator& star_end_string, std::string::const_iterator buf_end, std::string& val)
+      template<class t_iterator>
+      inline bool match_word(t_iterator& star_end_string, t_iterator buf_end, std::string& val)
       {
         try
         {
@@ -217,11 +223,12 @@ namespace misc_utils
           return false;
         }
       }
-      inline bool match_word_with_extrasymb(std::string::const_iterator& star_end_string, std::string::const_iterator buf_end, std::string& val)
+      template<class t_iterator>
+      inline bool match_word_with_extrasymb(t_iterator& star_end_string, t_iterator buf_end, std::string& val)
       {
         val.clear();
 
-        for(std::string::const_iterator it = star_end_string;it != buf_end;it++)
+        for(t_iterator it = star_end_string;it != buf_end;it++)
         {
           if(!isalnum(*it) && *it != '-' && *it != '_')
           {
@@ -236,11 +243,12 @@ namespace misc_utils
         }
         return false;
       }
-      inline bool match_word_til_equal_mark(std::string::const_iterator& star_end_string, std::string::const_iterator buf_end, std::string::const_iterator& word_end)
+      template<class t_iterator>
+      inline bool match_word_til_equal_mark(t_iterator& star_end_string, t_iterator buf_end, t_iterator& word_end)
       {
         word_end = star_end_string;
 
-        for(std::string::const_iterator it = star_end_string;it != buf_end;it++)
+        for(t_iterator it = star_end_string;it != buf_end;it++)
         {
           if(isspace(*it))
           {
@@ -81,10 +81,12 @@ namespace epee
       //-------------------------------------------------------------------------------
       bool		store_to_binary(binarybuffer& target);
       bool		load_from_binary(const binarybuffer& target);
+      bool		load_from_binary(const void* source, size_t size);
       template<class trace_policy>
       bool		  dump_as_xml(std::string& targetObj, const std::string& root_name = "");
       bool		  dump_as_json(std::string& targetObj, size_t indent = 0);
       bool		  load_from_json(const std::string& source);
+      bool		  load_from_json(const char* source, size_t size);
 
     private:
       section m_root;
@@ -122,6 +124,13 @@ namespace epee
       return json::load_from_json(source, *this);
       CATCH_ENTRY("portable_storage::load_from_json", false)
     }
+    inline
+    bool		portable_storage::load_from_json(const char* source, size_t size)
+    {
+      TRY_ENTRY();
+      return json::load_from_json(source, size, *this);
+      CATCH_ENTRY("portable_storage::load_from_json", false)
+    }
 
     template<class trace_policy>
     bool		  portable_storage::dump_as_xml(std::string& targetObj, const std::string& root_name)
@@ -146,14 +155,19 @@ namespace epee
     }
     inline
     bool		portable_storage::load_from_binary(const binarybuffer& source)
+    {
+      return load_from_binary(source.data(), source.size());
+    }
+    inline
+    bool		portable_storage::load_from_binary(const void* source, size_t size)
     {
       m_root.m_entries.clear();
-      if(source.size() < sizeof(storage_block_header))
+      if(size < sizeof(storage_block_header))
       {
-        LOG_ERROR("portable_storage: wrong binary format, packet size = " << source.size() << " less than expected sizeof(storage_block_header)=" << sizeof(storage_block_header));
+        LOG_ERROR("portable_storage: wrong binary format, packet size = " << size << " less than expected sizeof(storage_block_header)=" << sizeof(storage_block_header));
         return false;
       }
-      storage_block_header* pbuff = (storage_block_header*)source.data();
+      const storage_block_header* pbuff = (const storage_block_header*)source;
       if(pbuff->m_signature_a != PORTABLE_STORAGE_SIGNATUREA || 
         pbuff->m_signature_b != PORTABLE_STORAGE_SIGNATUREB 
         )
@@ -167,7 +181,7 @@ namespace epee
         return false;
       }
       TRY_ENTRY();
-      throwable_buffer_reader buf_reader(source.data()+sizeof(storage_block_header), source.size()-sizeof(storage_block_header));
+      throwable_buffer_reader buf_reader((const char*)source+sizeof(storage_block_header), size-sizeof(storage_block_header));
       buf_reader.read(m_root);
       return true;//TODO:
       CATCH_ENTRY("portable_storage::load_from_binary", false);
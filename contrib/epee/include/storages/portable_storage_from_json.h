@@ -41,11 +41,11 @@ namespace epee
       {
         ASSERT_MES_AND_THROW("json parse error");
       }*/
-      template<class t_storage>
-      inline void run_handler(typename t_storage::hsection current_section, std::string::const_iterator& sec_buf_begin, std::string::const_iterator buf_end, t_storage& stg)
+      template<class t_storage, class t_iterator>
+      inline void run_handler(typename t_storage::hsection current_section, t_iterator& sec_buf_begin, t_iterator buf_end, t_storage& stg)
       {
 
-        std::string::const_iterator sub_element_start;
+        t_iterator sub_element_start;
         std::string name;        
         typename t_storage::harray h_array = nullptr;
         enum match_state
@@ -72,7 +72,7 @@ namespace epee
 
         match_state state = match_state_lookup_for_section_start;
         array_mode array_md = array_mode_undifined;
-        std::string::const_iterator it = sec_buf_begin;
+        t_iterator it = sec_buf_begin;
         for(;it != buf_end;it++)
         {
           switch (state)
@@ -355,12 +355,12 @@ namespace epee
 }
 */
       template<class t_storage>
-      inline bool load_from_json(const std::string& buff_json, t_storage& stg)
+      inline bool load_from_json(const char* buff_json, size_t buff_size, t_storage& stg)
       {
-        std::string::const_iterator sec_buf_begin  = buff_json.begin();
+        const char* sec_buf_begin = buff_json;
         try
         {
-          run_handler(nullptr, sec_buf_begin, buff_json.end(), stg);
+          run_handler(nullptr, sec_buf_begin, buff_json + buff_size, stg);
           return true;
         }
         catch(const std::exception& ex)
@@ -374,6 +374,12 @@ namespace epee
           return false;
         }
       }
+
+      template<class t_storage>
+      inline bool load_from_json(const std::string& buff_json, t_storage& stg)
+      {
+        return load_from_json(buff_json.data(), buff_json.size(), stg);
+      }
     }
   }
 }
\ No newline at end of file
@@ -0,0 +1,538 @@
+// Copyright (c) 2006-2013, Andrey N. Sabelnikov, www.sabelnikov.net
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Andrey N. Sabelnikov nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER  BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+
+#pragma once
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define EPEE_JSON_VIEW_SSE2
+#endif
+#include "portable_storage_base.h"
+#include "portable_storage_val_converters.h"
+
+namespace epee
+{
+  namespace serialization
+  {
+    /************************************************************************/
+    /* Read-only storage over a JSON buffer for the load() of KV_SERIALIZE  */
+    /* structs, which fills them straight from the buffer instead of going  */
+    /* through a portable_storage tree. The buffer is indexed in one pass,  */
+    /* strings are found with SSE2 and copied once, into their target.      */
+    /* It is strict: whatever it does not read exactly like                 */
+    /* json::load_from_json and portable_storage would, from odd syntax to  */
+    /* value conversions, sets need_fallback() and the caller has to load   */
+    /* the struct the usual way. The buffer has to outlive the storage.     */
+    /************************************************************************/
+    class portable_storage_json_view
+    {
+    public:
+      struct node;
+      struct array_cursor;
+      typedef const node* hsection;
+      typedef array_cursor* harray;
+      typedef storage_entry meta_entry;
+
+      enum node_type
+      {
+        node_object,
+        node_array,
+        node_string,
+        node_number,
+        node_boolean,
+        node_null
+      };
+
+      struct node
+      {
+        node_type m_type;
+        //string: has escape sequences, number: negative, boolean: the value
+        bool m_flag;
+        uint64_t m_magnitude;
+        //string contents, member name for the members of an object
+        const char* m_begin;
+        const char* m_end;
+        const char* m_name;
+        size_t m_name_size;
+        //indexes of the first member or element and of the next sibling, zero when there is none
+        size_t m_first;
+        size_t m_next;
+      };
+
+      struct array_cursor
+      {
+        size_t m_current;
+      };
+
+      portable_storage_json_view(): m_need_fallback(false)
+      {
+        m_empty.m_type = node_object;
+        m_empty.m_first = 0;
+        m_empty.m_next = 0;
+      }
+
+      //indexes the buffer, false when it has to go to json::load_from_json
+      bool load_from_json(const char* buff_json, size_t buff_size)
+      {
+        m_nodes.clear();
+        m_cursors.clear();
+        m_need_fallback = false;
+        m_end = buff_json + buff_size;
+        m_nodes.resize(1);
+        m_nodes[0].m_next = 0;
+        m_nodes[0].m_name = nullptr;
+        m_nodes[0].m_name_size = 0;
+
+        const char* it = skip_space(buff_json);
+        if(it == m_end || *it != '{')
+          return fail();
+        it = parse_object(it, 0);
+        if(!it || skip_space(it) != m_end)
+          return fail();
+
+        return true;
+      }
+
+      bool need_fallback() const { return m_need_fallback; }
+
+      template<class t_value>
+      bool get_value(const char* value_name, t_value& val, hsection hparent_section)
+      {
+        const node* n = find(value_name, hparent_section);
+        return n && read_value(*n, false, val);
+      }
+
+      //a missing section reads as an empty one, as portable_storage creates it
+      hsection open_section(const char* section_name, hsection hparent_section, bool create_if_notexist = false)
+      {
+        const node* n = find(section_name, hparent_section);
+        if(!n)
+          return create_if_notexist ? &m_empty : nullptr;
+        if(n->m_type != node_object)
+          return fallback<hsection>();
+        return n;
+      }
+
+      template<class t_value>
+      harray get_first_value(const char* value_name, t_value& target, hsection hparent_section)
+      {
+        const node* n = find(value_name, hparent_section);
+        if(!n)
+          return nullptr;
+        if(n->m_type != node_array || m_nodes[n->m_first].m_type == node_object || !read_value(m_nodes[n->m_first], true, target))
+          return fallback<harray>();
+
+        m_cursors.push_back(array_cursor());
+        m_cursors.back().m_current = n->m_first;
+        return &m_cursors.back();
+      }
+
+      template<class t_value>
+      bool get_next_value(harray hval_array, t_value& target)
+      {
+        size_t next = m_nodes[hval_array->m_current].m_next;
+        if(!next)
+          return false;
+        hval_array->m_current = next;
+        return read_value(m_nodes[next], true, target);
+      }
+
+      harray get_first_section(const char* pSectionName, hsection& h_child_section, hsection hparent_section)
+      {
+        const node* n = find(pSectionName, hparent_section);
+        if(!n)
+          return nullptr;
+        if(n->m_type != node_array || m_nodes[n->m_first].m_type != node_object)
+          return fallback<harray>();
+
+        m_cursors.push_back(array_cursor());
+        m_cursors.back().m_current = n->m_first;
+        h_child_section = &m_nodes[n->m_first];
+        return &m_cursors.back();
+      }
+
+      bool get_next_section(harray hsec_array, hsection& h_child_section)
+      {
+        size_t next = m_nodes[hsec_array->m_current].m_next;
+        if(!next)
+          return false;
+        hsec_array->m_current = next;
+        h_child_section = &m_nodes[next];
+        return true;
+      }
+
+    private:
+      std::vector<node> m_nodes;
+      std::deque<array_cursor> m_cursors;
+      node m_empty;
+      const char* m_end;
+      bool m_need_fallback;
+
+      bool fail()
+      {
+        m_need_fallback = true;
+        return false;
+      }
+
+      template<class t_result>
+      t_result fallback()
+      {
+        m_need_fallback = true;
+        return t_result();
+      }
+
+      static bool is_space(char ch)
+      {
+        return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\v' || ch == '\f';
+      }
+
+      static bool is_alpha(char ch)
+      {
+        return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+      }
+
+      const char* skip_space(const char* it) const
+      {
+        while(it != m_end && is_space(*it))
+          it++;
+        return it;
+      }
+
+      //first '"' or '\\' at or after it, m_end when there is none
+      const char* find_quote_or_escape(const char* it) const
+      {
+#ifdef EPEE_JSON_VIEW_SSE2
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        while(m_end - it >= 16)
+        {
+          __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+          int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+          if(mask)
+          {
+#if defined(_MSC_VER)
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return it + index;
+#else
+            return it + __builtin_ctz(mask);
+#endif
+          }
+          it += 16;
+        }
+#endif
+        while(it != m_end && *it != '"' && *it != '\\')
+          it++;
+        return it;
+      }
+
+      //it is at the opening quote, returns the position after the closing one
+      const char* parse_string(const char* it, node& n)
+      {
+        n.m_type = node_string;
+        n.m_flag = false;
+        n.m_begin = ++it;
+        for(;;)
+        {
+          it = find_quote_or_escape(it);
+          if(it == m_end)
+            return nullptr;
+          if(*it == '"')
+            break;
+          //only the escapes json::load_from_json knows, it keeps any other escaped character as it is and complains
+          if(++it == m_end || !strchr("bfnrtv'\"\\/", *it) || !*it)
+            return nullptr;
+          n.m_flag = true;
+          it++;
+        }
+        n.m_end = it;
+        return it + 1;
+      }
+
+      //integers only, in the range json::load_from_json casts them to: uint64_t or int64_t members, int64_t array elements
+      const char* parse_number(const char* it, node& n, bool in_array)
+      {
+        n.m_type = node_number;
+        n.m_flag = *it == '-';
+        if(n.m_flag)
+          it++;
+        if(it == m_end || *it < '0' || *it > '9')
+          return nullptr;
+
+        uint64_t value = 0;
+        for(; it != m_end && *it >= '0' && *it <= '9'; it++)
+        {
+          uint64_t digit = *it - '0';
+          if(value > (UINT64_MAX - digit) / 10)
+            return nullptr;
+          value = value * 10 + digit;
+        }
+
+        uint64_t limit = n.m_flag ? static_cast<uint64_t>(INT64_MAX) + 1 : in_array ? static_cast<uint64_t>(INT64_MAX) : UINT64_MAX;
+        if(value > limit || (it != m_end && (*it == '.' || *it == 'e' || *it == 'E')))
+          return nullptr;
+        n.m_magnitude = value;
+        return it;
+      }
+
+      const char* parse_word(const char* it, node& n)
+      {
+        static const char* const words[] = {"true", "false", "null"};
+        for(size_t i = 0; i != 3; i++)
+        {
+          size_t size = strlen(words[i]);
+          if(static_cast<size_t>(m_end - it) >= size && !memcmp(it, words[i], size) && (m_end - it == static_cast<ptrdiff_t>(size) || !is_alpha(it[size])))
+          {
+            n.m_type = i == 2 ? node_null : node_boolean;
+            n.m_flag = i == 0;
+            return it + size;
+          }
+        }
+        return nullptr;
+      }
+
+      //value at it, which is not a space, into the node at index, returns the position after the value
+      const char* parse_value(const char* it, size_t index, bool in_array)
+      {
+        m_nodes[index].m_first = 0;
+        m_nodes[index].m_next = 0;
+        if(*it == '"')
+          return parse_string(it, m_nodes[index]);
+        if(*it == '-' || (*it >= '0' && *it <= '9'))
+          return parse_number(it, m_nodes[index], in_array);
+        if(*it == '{')
+          return parse_object(it, index);
+        if(*it == '[' && !in_array)
+          return parse_array(it, index);
+        return parse_word(it, m_nodes[index]);
+      }
+
+      //appends the member or element that follows the node at last, the first one of the node at parent when last is zero
+      size_t append_child(size_t parent, size_t last)
+      {
+        size_t child = m_nodes.size();
+        m_nodes.resize(child + 1);
+        if(last)
+          m_nodes[last].m_next = child;
+        else
+          m_nodes[parent].m_first = child;
+        return child;
+      }
+
+      const char* parse_object(const char* it, size_t index)
+      {
+        m_nodes[index].m_type = node_object;
+        m_nodes[index].m_first = 0;
+        size_t last = 0;
+        it = skip_space(it + 1);
+        if(it != m_end && *it == '}')
+          return it + 1;
+
+        for(;;)
+        {
+          if(it == m_end || *it != '"')
+            return nullptr;
+          const char* name = ++it;
+          it = find_quote_or_escape(it);
+          if(it == m_end || *it != '"')
+            return nullptr;
+          size_t name_size = it - name;
+          it = skip_space(it + 1);
+          if(it == m_end || *it != ':')
+            return nullptr;
+          it = skip_space(it + 1);
+          if(it == m_end)
+            return nullptr;
+
+          last = append_child(index, last);
+          it = parse_value(it, last, false);
+          if(!it)
+            return nullptr;
+          m_nodes[last].m_name = name;
+          m_nodes[last].m_name_size = name_size;
+
+          it = skip_space(it);
+          if(it == m_end)
+            return nullptr;
+          if(*it == '}')
+            return it + 1;
+          if(*it != ',')
+            return nullptr;
+          it = skip_space(it + 1);
+        }
+      }
+
+      //elements of one kind, json::load_from_json takes the first one for the kind of the whole array
+      const char* parse_array(const char* it, size_t index)
+      {
+        m_nodes[index].m_type = node_array;
+        m_nodes[index].m_first = 0;
+        size_t last = 0;
+        it = skip_space(it + 1);
+        if(it != m_end && *it == ']')
+          return it + 1;
+
+        for(;;)
+        {
+          if(it == m_end)
+            return nullptr;
+          size_t element = append_child(index, last);
+          it = parse_value(it, element, true);
+          if(!it || m_nodes[element].m_type == node_null || (last && m_nodes[last].m_type != m_nodes[element].m_type))
+            return nullptr;
+          m_nodes[element].m_name = nullptr;
+          m_nodes[element].m_name_size = 0;
+          last = element;
+
+          it = skip_space(it);
+          if(it == m_end)
+            return nullptr;
+          if(*it == ']')
+            return it + 1;
+          if(*it != ',')
+            return nullptr;
+          it = skip_space(it + 1);
+        }
+      }
+
+      //member of the name, null when there is none. Null members and empty arrays are left out of a
+      //portable_storage, a name given twice leaves the choice to it.
+      const node* find(const char* name, hsection hparent_section)
+      {
+        const node* parent = hparent_section ? hparent_section : &m_nodes[0];
+        size_t name_size = strlen(name);
+        const node* found = nullptr;
+        for(size_t index = parent->m_first; index; index = m_nodes[index].m_next)
+        {
+          const node* member = &m_nodes[index];
+          if(member->m_name_size != name_size || memcmp(member->m_name, name, name_size) || member->m_type == node_null || (member->m_type == node_array && !member->m_first))
+            continue;
+          if(found)
+            return fallback<const node*>();
+          found = member;
+        }
+        return found;
+      }
+
+      static void unescape(const node& n, std::string& val)
+      {
+        val.clear();
+        val.reserve(n.m_end - n.m_begin);
+        for(const char* it = n.m_begin; it != n.m_end; it++)
+        {
+          if(*it != '\\')
+          {
+            val.push_back(*it);
+            continue;
+          }
+
+          switch(*++it)
+          {
+          case 'b': val.push_back(0x08); break;
+          case 'f': val.push_back(0x0C); break;
+          case 'n': val.push_back('\n'); break;
+          case 'r': val.push_back('\r'); break;
+          case 't': val.push_back('\t'); break;
+          case 'v': val.push_back('\v'); break;
+          default: val.push_back(*it);
+          }
+        }
+      }
+
+      template<class from_type, class to_type>
+      bool convert(const from_type& from, to_type& to)
+      {
+        try
+        {
+          convert_t(from, to);
+          return true;
+        }
+        catch(const std::exception&)
+        {
+          return fail();
+        }
+      }
+
+      //the value portable_storage would hold, converted the way it would
+      template<class t_value>
+      bool read_value(const node& n, bool in_array, t_value& val)
+      {
+        switch(n.m_type)
+        {
+        case node_string:
+          return fail();
+        case node_number:
+          if(in_array || n.m_flag)
+            return convert(static_cast<int64_t>(n.m_flag ? 0 - n.m_magnitude : n.m_magnitude), val);
+          return convert(n.m_magnitude, val);
+        case node_boolean:
+          return convert(n.m_flag, val);
+        default:
+          return fail();
+        }
+      }
+
+      bool read_value(const node& n, bool in_array, std::string& val)
+      {
+        if(n.m_type != node_string)
+          return fail();
+        if(n.m_flag)
+          unescape(n, val);
+        else
+          val.assign(n.m_begin, n.m_end);
+        return true;
+      }
+
+      bool read_value(const node& n, bool in_array, storage_entry& val)
+      {
+        switch(n.m_type)
+        {
+        case node_string:
+          {
+            std::string str;
+            read_value(n, in_array, str);
+            val = std::move(str);
+            return true;
+          }
+        case node_number:
+          if(in_array || n.m_flag)
+            val = static_cast<int64_t>(n.m_flag ? 0 - n.m_magnitude : n.m_magnitude);
+          else
+            val = n.m_magnitude;
+          return true;
+        case node_boolean:
+          val = n.m_flag;
+          return true;
+        default:
+          return fail();
+        }
+      }
+    };
+  }
+}
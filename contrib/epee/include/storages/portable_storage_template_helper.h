@@ -27,6 +27,7 @@
 #pragma once
 #include "parserse_base_utils.h"
 #include "portable_storage.h"
+#include "portable_storage_json_view.h"
 #include "file_io_utils.h"
 
 namespace epee
@@ -35,10 +36,20 @@ namespace epee
   {
     //-----------------------------------------------------------------------------------------------------------
     template<class t_struct>
-    bool load_t_from_json(t_struct& out, const std::string& json_buff)
+    bool load_t_from_json(t_struct& out, const char* json_buff, size_t json_size)
     {
+      //the view reads the usual responses straight into out, anything it is not sure about goes through a portable_storage,
+      //which finds whatever the view already set in out and sets it again
+      portable_storage_json_view view;
+      if(view.load_from_json(json_buff, json_size))
+      {
+        bool rs = out.load(view);
+        if(!view.need_fallback())
+          return rs;
+      }
+
       portable_storage ps;
-      bool rs = ps.load_from_json(json_buff);
+      bool rs = ps.load_from_json(json_buff, json_size);
       if(!rs)
         return false;
 
@@ -46,6 +57,12 @@ namespace epee
     }
     //-----------------------------------------------------------------------------------------------------------
     template<class t_struct>
+    bool load_t_from_json(t_struct& out, const std::string& json_buff)
+    {
+      return load_t_from_json(out, json_buff.data(), json_buff.size());
+    }
+    //-----------------------------------------------------------------------------------------------------------
+    template<class t_struct>
     bool load_t_from_json_file(t_struct& out, const std::string& json_file)
     {
       std::string f_buff;
@@ -92,6 +109,17 @@ namespace epee
     }
     //-----------------------------------------------------------------------------------------------------------
     template<class t_struct>
+    bool load_t_from_binary(t_struct& out, const char* binary_buff, size_t binary_size)
+    {
+      portable_storage ps;
+      bool rs = ps.load_from_binary(binary_buff, binary_size);
+      if(!rs)
+        return false;
+
+      return out.load(ps);
+    }
+    //-----------------------------------------------------------------------------------------------------------
+    template<class t_struct>
     bool load_t_from_binary_file(t_struct& out, const std::string& binary_file)
     {
       std::string f_buff;
@@ -40,6 +40,13 @@
 #include <boost/algorithm/string/compare.hpp>
 #include <boost/algorithm/string.hpp>
 #include "warnings.h"
+//EPEE_HEX_SCALAR keeps the hex conversions on their scalar loops, for testing them against the vector ones
+#if !defined(EPEE_HEX_SCALAR)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define EPEE_HEX_SSE2
+#endif
+#endif
 
 
 #ifndef OUT
@@ -165,6 +172,108 @@ namespace string_tools
     }
   }
   //----------------------------------------------------------------------------
+  //writes 2 * size lowercase hex digits of src to dst
+  inline void buff_to_hex_nodelimer(const char* src, size_t size, char* dst)
+  {
+    static const char digits[] = "0123456789abcdef";
+    const unsigned char* it = reinterpret_cast<const unsigned char*>(src);
+    const unsigned char* end = it + size;
+#ifdef EPEE_HEX_SSE2
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i gap = _mm_set1_epi8('a' - '0' - 10);
+    for(; end - it >= 16; it += 16, dst += 32)
+    {
+      __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+      __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+      __m128i lo = _mm_and_si128(bytes, mask);
+      hi = _mm_add_epi8(_mm_add_epi8(hi, zero), _mm_and_si128(_mm_cmpgt_epi8(hi, nine), gap));
+      lo = _mm_add_epi8(_mm_add_epi8(lo, zero), _mm_and_si128(_mm_cmpgt_epi8(lo, nine), gap));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi8(hi, lo));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+#endif
+    for(; it != end; it++)
+    {
+      *dst++ = digits[*it >> 4];
+      *dst++ = digits[*it & 0x0F];
+    }
+  }
+  //----------------------------------------------------------------------------
+  inline std::string buff_to_hex_nodelimer(const std::string& s)
+  {
+    std::string res(2 * s.size(), '\0');
+    if(!s.empty())
+      buff_to_hex_nodelimer(s.data(), s.size(), &res[0]);
+    return res;
+  }
+  //----------------------------------------------------------------------------
+  //writes (size + 1) / 2 bytes to dst, a last digit without a pair makes a byte of its own. Only
+  //hex digits are accepted, false when there is anything else in src.
+  inline bool parse_hexstr_to_binbuff(const char* src, size_t size, char* dst)
+  {
+    const char* end = src + size;
+#ifdef EPEE_HEX_SSE2
+    {
+      //chars from 0x80 up are negative for the signed compares and fail both ranges
+      const __m128i below_digits = _mm_set1_epi8('0' - 1);
+      const __m128i above_digits = _mm_set1_epi8('9' + 1);
+      const __m128i below_letters = _mm_set1_epi8('a' - 1);
+      const __m128i above_letters = _mm_set1_epi8('f' + 1);
+      const __m128i lower = _mm_set1_epi8(0x20);
+      const __m128i zero = _mm_set1_epi8('0');
+      const __m128i letter = _mm_set1_epi8('a' - 10);
+      const __m128i low_byte = _mm_set1_epi16(0x00FF);
+      for(; end - src >= 32; src += 32, dst += 16)
+      {
+        __m128i values[2];
+        for(size_t i = 0; i != 2; i++)
+        {
+          __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16 * i));
+          __m128i folded = _mm_or_si128(chars, lower);
+          __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(chars, below_digits), _mm_cmpgt_epi8(above_digits, chars));
+          __m128i is_letter = _mm_and_si128(_mm_cmpgt_epi8(folded, below_letters), _mm_cmpgt_epi8(above_letters, folded));
+          if(_mm_movemask_epi8(_mm_or_si128(is_digit, is_letter)) != 0xFFFF)
+            return false;
+          __m128i nibbles = _mm_or_si128(_mm_and_si128(is_digit, _mm_sub_epi8(chars, zero)), _mm_and_si128(is_letter, _mm_sub_epi8(folded, letter)));
+          //the first digit of a pair is the low byte of its 16-bit word
+          values[i] = _mm_and_si128(_mm_or_si128(_mm_slli_epi16(nibbles, 4), _mm_srli_epi16(nibbles, 8)), low_byte);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(values[0], values[1]));
+      }
+    }
+#endif
+    int hi = 0;
+    for(size_t i = 0; src != end; src++, i++)
+    {
+      int v;
+      if(*src >= '0' && *src <= '9')
+        v = *src - '0';
+      else if((*src | 0x20) >= 'a' && (*src | 0x20) <= 'f')
+        v = (*src | 0x20) - 'a' + 10;
+      else
+        return false;
+
+      if(i & 1)
+        *dst++ = static_cast<char>(hi << 4 | v);
+      else if(src + 1 == end)
+        *dst++ = static_cast<char>(v);
+      else
+        hi = v;
+    }
+    return true;
+  }
+  //----------------------------------------------------------------------------
+  inline bool parse_hexstr_to_binbuff(const std::string& s, std::string& res)
+  {
+    res.resize((s.size() + 1) / 2);
+    if(s.empty() || parse_hexstr_to_binbuff(s.data(), s.size(), &res[0]))
+      return true;
+    res.clear();
+    return false;
+  }
+  //----------------------------------------------------------------------------
   template<class t_pod_type>
   bool parse_tpod_from_hex_string(const std::string& str_hash, t_pod_type& t_pod)
   {
@@ -13,6 +13,12 @@
 #include <stdint.h>
 #include "blake256.h"
 
+// SSE2 is there on every x86-64 CPU, the compression function runs four G at a time with it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLAKE256_SSE2
+#include <emmintrin.h>
+#endif
+
 #define U8TO32(p) \
     (((uint32_t)((p)[0]) << 24) | ((uint32_t)((p)[1]) << 16) |    \
      ((uint32_t)((p)[2]) <<  8) | ((uint32_t)((p)[3])      ))
@@ -50,6 +56,57 @@ static const uint8_t padding[] = {
 };
 
 
+#ifdef BLAKE256_SSE2
+
+#define ROT128(x,n) _mm_or_si128(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - (n)))
+#define ROT128_16(x) _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xb1), 0xb1)
+#define G128(e)                                                                             \
+    buf = _mm_set_epi32(m[sigma[i][e+6]] ^ cst[sigma[i][e+7]], m[sigma[i][e+4]] ^ cst[sigma[i][e+5]], \
+                        m[sigma[i][e+2]] ^ cst[sigma[i][e+3]], m[sigma[i][e]] ^ cst[sigma[i][e+1]]); \
+    row1 = _mm_add_epi32(_mm_add_epi32(row1, buf), row2);                                  \
+    row4 = ROT128_16(_mm_xor_si128(row4, row1));                                           \
+    row3 = _mm_add_epi32(row3, row4);                                                      \
+    row2 = ROT128(_mm_xor_si128(row2, row3), 12);                                          \
+    buf = _mm_set_epi32(m[sigma[i][e+7]] ^ cst[sigma[i][e+6]], m[sigma[i][e+5]] ^ cst[sigma[i][e+4]], \
+                        m[sigma[i][e+3]] ^ cst[sigma[i][e+2]], m[sigma[i][e+1]] ^ cst[sigma[i][e]]); \
+    row1 = _mm_add_epi32(_mm_add_epi32(row1, buf), row2);                                  \
+    row4 = ROT128(_mm_xor_si128(row4, row1), 8);                                           \
+    row3 = _mm_add_epi32(row3, row4);                                                      \
+    row2 = ROT128(_mm_xor_si128(row2, row3), 7);
+
+// The four G of a column or diagonal step at once, v[0..3], v[4..7], v[8..11] and v[12..15] in one register each
+void blake256_compress(state *S, const uint8_t *block) {
+    __m128i row1, row2, row3, row4, buf, s;
+    uint32_t m[16], i;
+
+    for (i = 0; i < 16; ++i) m[i] = U8TO32(block + i * 4);
+    s = _mm_loadu_si128((const __m128i *) S->s);
+    row1 = _mm_loadu_si128((const __m128i *) &S->h[0]);
+    row2 = _mm_loadu_si128((const __m128i *) &S->h[4]);
+    row3 = _mm_xor_si128(s, _mm_loadu_si128((const __m128i *) &cst[0]));
+    row4 = _mm_loadu_si128((const __m128i *) &cst[4]);
+
+    if (S->nullt == 0) {
+        row4 = _mm_xor_si128(row4, _mm_set_epi32(S->t[1], S->t[1], S->t[0], S->t[0]));
+    }
+
+    for (i = 0; i < 14; ++i) {
+        G128(0);
+        row2 = _mm_shuffle_epi32(row2, 0x39);
+        row3 = _mm_shuffle_epi32(row3, 0x4e);
+        row4 = _mm_shuffle_epi32(row4, 0x93);
+        G128(8);
+        row2 = _mm_shuffle_epi32(row2, 0x93);
+        row3 = _mm_shuffle_epi32(row3, 0x4e);
+        row4 = _mm_shuffle_epi32(row4, 0x39);
+    }
+
+    _mm_storeu_si128((__m128i *) &S->h[0], _mm_xor_si128(_mm_loadu_si128((const __m128i *) &S->h[0]), _mm_xor_si128(_mm_xor_si128(row1, row3), s)));
+    _mm_storeu_si128((__m128i *) &S->h[4], _mm_xor_si128(_mm_loadu_si128((const __m128i *) &S->h[4]), _mm_xor_si128(_mm_xor_si128(row2, row4), s)));
+}
+
+#else
+
 void blake256_compress(state *S, const uint8_t *block) {
     uint32_t v[16], m[16], i;
 
@@ -97,6 +154,8 @@ void blake256_compress(state *S, const uint8_t *block) {
     for (i = 0; i < 8;  ++i) S->h[i] ^= S->s[i % 4];
 }
 
+#endif
+
 void blake256_init(state *S) {
     S->h[0] = 0x6A09E667;
     S->h[1] = 0xBB67AE85;
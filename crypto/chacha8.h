@@ -14,6 +14,7 @@
 #include <memory.h>
 
 #include "hash.h"
+#include "scratchpad.h"
 
 namespace crypto {
   extern "C" {
@@ -47,9 +48,8 @@ namespace crypto {
   inline void generate_chacha8_key(std::string password, chacha8_key& key) {
     static_assert(sizeof(chacha8_key) <= sizeof(hash), "Size of hash must be at least that of chacha8_key");
     char pwd_hash[HASH_SIZE];
-    uint8_t* long_state = (uint8_t*) malloc(1 << 21);
-    crypto::cn_slow_hash(password.data(), password.size(), pwd_hash, long_state);
-    free(long_state);
+    crypto::scratchpad scratchpad;
+    crypto::cn_slow_hash(password.data(), password.size(), pwd_hash, scratchpad.data());
     memcpy(&key, pwd_hash, sizeof(key));
     memset(pwd_hash, 0, sizeof(pwd_hash));
   }
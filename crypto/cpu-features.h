@@ -0,0 +1,20 @@
+// Copyright (c) 2012-2013 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+// Instruction set extensions the CPU and the OS support, as detected by slow-hash.c.
+// Code built with the flags of an extension only runs once its bit is set here.
+enum
+{
+    CPU_AES = 1 << 0,
+    CPU_AVX2 = 1 << 1,
+    CPU_BMI2 = 1 << 2,
+    CPU_BMI = 1 << 3,
+    CPU_SSSE3 = 1 << 4,
+    CPU_VAES = 1 << 5,
+    CPU_AVX512F = 1 << 6
+};
+
+int cpu_features(void);
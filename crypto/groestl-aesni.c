@@ -0,0 +1,196 @@
+/* Groestl-256 on AES-NI and SSSE3, built with both enabled and only called
+ * once cpuid reports them, see hash-extra-groestl.c.
+ *
+ * The state is kept as its eight rows, with the row of P in the low and the
+ * one of Q in the high half of a register, so that both permutations of the
+ * compression function go through every instruction together. aesenclast
+ * with a zero key does SubBytes, a byte shuffle in front of it does ShiftBytes
+ * and undoes the ShiftRows of AES.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#if defined(_MSC_VER) || defined(__INTEL_COMPILER)
+#include <intrin.h>
+#else
+#include <wmmintrin.h>
+#endif
+
+#include "groestl.h"
+
+#if defined(_MSC_VER)
+#define ALIGN16(x) __declspec(align(16)) x
+#else
+#define ALIGN16(x) x __attribute__ ((aligned(16)))
+#endif
+
+/* ShiftBytes of row k of P and Q, composed with the inverse of ShiftRows */
+static const ALIGN16(uint8_t shift_masks[ROWS][16]) = {
+  {  0, 14, 11,  7,  4,  1, 15, 12,  9,  5,  2,  8, 13, 10,  6,  3 },
+  {  1,  8, 13,  0,  5,  2,  9, 14, 11,  6,  3, 10, 15, 12,  7,  4 },
+  {  2, 10, 15,  1,  6,  3, 11,  8, 13,  7,  4, 12,  9, 14,  0,  5 },
+  {  3, 12,  9,  2,  7,  4, 13, 10, 15,  0,  5, 14, 11,  8,  1,  6 },
+  {  4, 13, 10,  3,  0,  5, 14, 11,  8,  1,  6, 15, 12,  9,  2,  7 },
+  {  5, 15, 12,  4,  1,  6,  8, 13, 10,  2,  7,  9, 14, 11,  3,  0 },
+  {  6,  9, 14,  5,  2,  7, 10, 15, 12,  3,  0, 11,  8, 13,  4,  1 },
+  {  7, 11,  8,  6,  3,  0, 12,  9, 14,  4,  1, 13, 10, 15,  5,  2 }
+};
+
+/* interleaves the bytes of the two halves of a register */
+static const uint8_t interleave_mask[16] = { 0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15 };
+
+/* multiplication by 2 in the field of the S-box, on every byte */
+static __m128i mul2(__m128i x) {
+  __m128i carry = _mm_and_si128(_mm_cmplt_epi8(x, _mm_setzero_si128()), _mm_set1_epi8(0x1b));
+  return _mm_xor_si128(_mm_add_epi8(x, x), carry);
+}
+
+/* 8x8 byte transpose of the 64 bytes in w, two rows to a register. Turns the
+ * column major bytes of a state into its rows and back. */
+static void transpose(__m128i w[4]) {
+  __m128i mask = _mm_loadu_si128((const __m128i*)interleave_mask);
+  __m128i a = _mm_shuffle_epi8(w[0], mask);
+  __m128i b = _mm_shuffle_epi8(w[1], mask);
+  __m128i c = _mm_shuffle_epi8(w[2], mask);
+  __m128i d = _mm_shuffle_epi8(w[3], mask);
+  __m128i ab0 = _mm_unpacklo_epi16(a, b);
+  __m128i ab1 = _mm_unpackhi_epi16(a, b);
+  __m128i cd0 = _mm_unpacklo_epi16(c, d);
+  __m128i cd1 = _mm_unpackhi_epi16(c, d);
+
+  w[0] = _mm_unpacklo_epi32(ab0, cd0);
+  w[1] = _mm_unpackhi_epi32(ab0, cd0);
+  w[2] = _mm_unpacklo_epi32(ab1, cd1);
+  w[3] = _mm_unpackhi_epi32(ab1, cd1);
+}
+
+#define MIX_ROW(b, a, t, i)                                                                              \
+  b[i] = _mm_xor_si128(_mm_xor_si128(a[((i) + 2) & 7], _mm_xor_si128(t[((i) + 4) & 7], t[((i) + 6) & 7])), \
+         mul2(_mm_xor_si128(_mm_xor_si128(_mm_xor_si128(t[i], a[((i) + 2) & 7]), _mm_xor_si128(a[((i) + 5) & 7], a[((i) + 7) & 7])), \
+                            mul2(_mm_xor_si128(t[((i) + 3) & 7], t[((i) + 6) & 7])))))
+
+/* MixBytes of a into b, row i becoming 2a[i] + 2a[i+1] + 3a[i+2] + 4a[i+3] + 5a[i+4] + 3a[i+5] + 5a[i+6] +
+ * 7a[i+7]. That is x + 2(y + 2z), x, y and z being sums of a[i+2] and the pair sums t[i] = a[i] + a[i+1]. */
+static void mix_bytes(const __m128i a[ROWS], __m128i b[ROWS]) {
+  __m128i t[ROWS];
+
+  t[0] = _mm_xor_si128(a[0], a[1]);
+  t[1] = _mm_xor_si128(a[1], a[2]);
+  t[2] = _mm_xor_si128(a[2], a[3]);
+  t[3] = _mm_xor_si128(a[3], a[4]);
+  t[4] = _mm_xor_si128(a[4], a[5]);
+  t[5] = _mm_xor_si128(a[5], a[6]);
+  t[6] = _mm_xor_si128(a[6], a[7]);
+  t[7] = _mm_xor_si128(a[7], a[0]);
+  MIX_ROW(b, a, t, 0);
+  MIX_ROW(b, a, t, 1);
+  MIX_ROW(b, a, t, 2);
+  MIX_ROW(b, a, t, 3);
+  MIX_ROW(b, a, t, 4);
+  MIX_ROW(b, a, t, 5);
+  MIX_ROW(b, a, t, 6);
+  MIX_ROW(b, a, t, 7);
+}
+
+#define SUB_SHIFT_ROW(x, i) x[i] = _mm_aesenclast_si128(_mm_shuffle_epi8(x[i], _mm_load_si128((const __m128i*)shift_masks[i])), _mm_setzero_si128())
+
+/* P on the low and Q on the high halves of the rows */
+static void permutation_pq(__m128i x[ROWS]) {
+  /* the column numbers shifted up of the P constant, and the Q ones, which are complemented */
+  const __m128i first = _mm_set_epi32(-1, -1, 0x70605040, 0x30201000);
+  const __m128i inner = _mm_set_epi32(-1, -1, 0, 0);
+  const __m128i last = _mm_set_epi32(0x8f9fafbf, 0xcfdfefff, 0, 0);
+  __m128i y[ROWS], round_number;
+  int round;
+
+  for (round = 0; round < ROUNDS512; round++) {
+    round_number = _mm_set1_epi8((char)round);
+    x[0] = _mm_xor_si128(x[0], _mm_xor_si128(first, _mm_move_epi64(round_number)));
+    x[1] = _mm_xor_si128(x[1], inner);
+    x[2] = _mm_xor_si128(x[2], inner);
+    x[3] = _mm_xor_si128(x[3], inner);
+    x[4] = _mm_xor_si128(x[4], inner);
+    x[5] = _mm_xor_si128(x[5], inner);
+    x[6] = _mm_xor_si128(x[6], inner);
+    x[7] = _mm_xor_si128(x[7], _mm_xor_si128(last, _mm_slli_si128(round_number, 8)));
+
+    SUB_SHIFT_ROW(x, 0);
+    SUB_SHIFT_ROW(x, 1);
+    SUB_SHIFT_ROW(x, 2);
+    SUB_SHIFT_ROW(x, 3);
+    SUB_SHIFT_ROW(x, 4);
+    SUB_SHIFT_ROW(x, 5);
+    SUB_SHIFT_ROW(x, 6);
+    SUB_SHIFT_ROW(x, 7);
+    mix_bytes(x, y);
+    memcpy(x, y, sizeof(y));
+  }
+}
+
+/* h <- P(h + m) + Q(m) + h, h in rows */
+static void compress(__m128i h[4], const uint8_t *block) {
+  __m128i m[4], p, x[ROWS];
+  int i;
+
+  for (i = 0; i < 4; i++) {
+    m[i] = _mm_loadu_si128((const __m128i*)(block + 16 * i));
+  }
+  transpose(m);
+  for (i = 0; i < 4; i++) {
+    p = _mm_xor_si128(h[i], m[i]);
+    x[2 * i] = _mm_unpacklo_epi64(p, m[i]);
+    x[2 * i + 1] = _mm_unpackhi_epi64(p, m[i]);
+  }
+  permutation_pq(x);
+  for (i = 0; i < 4; i++) {
+    h[i] = _mm_xor_si128(h[i], _mm_xor_si128(_mm_unpacklo_epi64(x[2 * i], x[2 * i + 1]), _mm_unpackhi_epi64(x[2 * i], x[2 * i + 1])));
+  }
+}
+
+void groestl_aesni(const BitSequence* data, size_t length, BitSequence* hashval) {
+  __m128i h[4], x[ROWS];
+  uint8_t last[2 * SIZE512];
+  uint64_t blocks = ((uint64_t)length + 1 + LENGTHFIELDLEN + SIZE512 - 1) / SIZE512;
+  size_t full = length / SIZE512;
+  size_t rest = length % SIZE512;
+  size_t padded = (size_t)(blocks - full) * SIZE512;
+  size_t i;
+
+  /* initial value, the big endian hash length 256 in the last column, its 0x01 in row 6 */
+  h[0] = _mm_setzero_si128();
+  h[1] = _mm_setzero_si128();
+  h[2] = _mm_setzero_si128();
+  h[3] = _mm_set_epi32(0, 0, 0x01000000, 0);
+
+  for (i = 0; i < full; i++) {
+    compress(h, data + i * SIZE512);
+  }
+
+  /* the '1' bit, the '0' bits and the number of blocks */
+  memcpy(last, data + full * SIZE512, rest);
+  last[rest] = 0x80;
+  memset(last + rest + 1, 0, padded - rest - 1);
+  for (i = 0; i < LENGTHFIELDLEN; i++) {
+    last[padded - 1 - i] = (uint8_t)(blocks >> (8 * i));
+  }
+  for (i = 0; i < padded; i += SIZE512) {
+    compress(h, last + i);
+  }
+
+  /* output transformation, P(h) + h truncated to its last columns */
+  for (i = 0; i < 4; i++) {
+    x[2 * i] = _mm_unpacklo_epi64(h[i], h[i]);
+    x[2 * i + 1] = _mm_unpackhi_epi64(h[i], h[i]);
+  }
+  permutation_pq(x);
+  for (i = 0; i < 4; i++) {
+    h[i] = _mm_xor_si128(h[i], _mm_unpacklo_epi64(x[2 * i], x[2 * i + 1]));
+  }
+  transpose(h);
+  _mm_storeu_si128((__m128i*)hashval, h[2]);
+  _mm_storeu_si128((__m128i*)(hashval + 16), h[3]);
+}
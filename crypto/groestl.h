@@ -10,6 +10,7 @@ typedef crypto_uint8 uint8_t;
 typedef crypto_uint32 uint32_t; 
 typedef crypto_uint64 uint64_t;
 */
+#include <stddef.h>
 #include <stdint.h>
 
 /* some sizes (number of bytes) */
@@ -49,6 +50,8 @@ typedef struct {
 void Update(hashState*, const BitSequence*, DataLength);
 void Final(hashState*, BitSequence*); */
 void groestl(const BitSequence*, DataLength, BitSequence*);
+/* the same for a whole number of bytes, on AES-NI and SSSE3 */
+void groestl_aesni(const BitSequence*, size_t, BitSequence*);
 /* NIST API end   */
 
 /*
@@ -5,8 +5,13 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "cpu-features.h"
 #include "groestl.h"
 
 void hash_extra_groestl(const void *data, size_t length, char *hash) {
-  groestl(data, length * 8, (uint8_t*)hash);
+  if ((cpu_features() & (CPU_AES | CPU_SSSE3)) == (CPU_AES | CPU_SSSE3)) {
+    groestl_aesni(data, length, (uint8_t*)hash);
+  } else {
+    groestl(data, length * 8, (uint8_t*)hash);
+  }
 }
@@ -49,11 +49,50 @@ void hash_process(union hash_state *state, const uint8_t *buf, size_t count);
 
 enum {
   HASH_SIZE = 32,
-  HASH_DATA_AREA = 136
+  HASH_DATA_AREA = 136,
+  CN_MAX_WAYS = 4
+};
+
+#if defined(_MSC_VER)
+#define CN_ALIGN16 __declspec(align(16))
+#else
+#define CN_ALIGN16 __attribute__ ((aligned(16)))
+#endif
+
+// Variants of cn_slow_hash mined by CryptoNote chains, told apart by scratchpad size and
+// iteration count. Every kernel computes all of them.
+enum cn_algorithm {
+  CN_ALGORITHM_CRYPTONIGHT,       // 2MB scratchpad, 2^20 iterations
+  CN_ALGORITHM_CRYPTONIGHT_LITE   // 1MB scratchpad, 2^19 iterations
+};
+
+// Per-thread state of cn_slow_hash, reusable across hashes without touching the heap.
+// long_state holds one scratchpad per way hashed at once, 2MB each fits every algorithm.
+struct cn_hash_context {
+  CN_ALIGN16 uint8_t round_keys[CN_MAX_WAYS][10 * 16];
+  uint8_t *long_state;
 };
 
 void cn_fast_hash(const void *data, size_t length, char *hash);
+// Hashes 4 inputs of length bytes stored back to back into 4 consecutive hashes, on AVX2 when the CPU
+// has it. hash may start at data as long as length is at least HASH_SIZE.
+void cn_fast_hash_x4(const void *data, size_t length, char *hash);
 void cn_slow_hash(const void *data, size_t length, char *hash, uint8_t* long_state);
+void cn_hash_context_init(struct cn_hash_context *context, uint8_t *long_state);
+void cn_slow_hash_ctx(struct cn_hash_context *context, const void *data, size_t length, char *hash);
+// Hashes ways (1 to CN_MAX_WAYS) inputs of length bytes stored back to back into ways consecutive hashes.
+// cn_slow_hash and cn_slow_hash_ctx hash with CN_ALGORITHM_CRYPTONIGHT.
+void cn_slow_hash_multi(struct cn_hash_context *context, enum cn_algorithm algorithm, size_t ways, const void *data, size_t length, char *hash);
+
+// Registry of the cn_slow_hash kernels. All of them compute the same hashes, the ones
+// the CPU cannot run are reported as unsupported. cn_slow_hash, cn_slow_hash_ctx and
+// cn_slow_hash_multi use the selected kernel, the last supported one by default.
+size_t cn_slow_hash_kernel_count(void);
+const char *cn_slow_hash_kernel_name(size_t kernel);
+bool cn_slow_hash_kernel_supported(size_t kernel);
+void cn_slow_hash_kernel(size_t kernel, struct cn_hash_context *context, enum cn_algorithm algorithm, size_t ways, const void *data, size_t length, char *hash);
+size_t cn_slow_hash_selected_kernel(void);
+void cn_slow_hash_select_kernel(size_t kernel);
 
 void hash_extra_blake(const void *data, size_t length, char *hash);
 void hash_extra_groestl(const void *data, size_t length, char *hash);
@@ -6,9 +6,12 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "cpu-features.h"
 #include "hash-ops.h"
 #include "keccak.h"
 
+void cn_fast_hash_x4_avx2(const void *data, size_t length, char *hash);
+
 void hash_permutation(union hash_state *state) {
   keccakf((uint64_t*)state, 24);
 }
@@ -22,3 +25,14 @@ void cn_fast_hash(const void *data, size_t length, char *hash) {
   hash_process(&state, data, length);
   memcpy(hash, &state, HASH_SIZE);
 }
+
+void cn_fast_hash_x4(const void *data, size_t length, char *hash) {
+  size_t i;
+  if (cpu_features() & CPU_AVX2) {
+    cn_fast_hash_x4_avx2(data, length, hash);
+    return;
+  }
+  for (i = 0; i < 4; ++i) {
+    cn_fast_hash(cpadd(data, i * length), length, hash + i * HASH_SIZE);
+  }
+}
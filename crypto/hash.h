@@ -37,10 +37,22 @@ namespace crypto {
     return h;
   }
 
+  inline void cn_fast_hash_x4(const void *data, std::size_t length, hash *hashes) {
+    cn_fast_hash_x4(data, length, reinterpret_cast<char *>(hashes));
+  }
+
   inline void cn_slow_hash(const void *data, std::size_t length, hash &hash, uint8_t* long_state) {
     cn_slow_hash(data, length, reinterpret_cast<char *>(&hash), long_state);
   }
 
+  inline void cn_slow_hash(cn_hash_context &context, const void *data, std::size_t length, hash &hash) {
+    cn_slow_hash_ctx(&context, data, length, reinterpret_cast<char *>(&hash));
+  }
+
+  inline void cn_slow_hash_multi(cn_hash_context &context, cn_algorithm algorithm, std::size_t ways, const void *data, std::size_t length, hash *hashes) {
+    cn_slow_hash_multi(&context, algorithm, ways, data, length, reinterpret_cast<char *>(hashes));
+  }
+
   inline void tree_hash(const hash *hashes, std::size_t count, hash &root_hash) {
     tree_hash(reinterpret_cast<const char (*)[HASH_SIZE]>(hashes), count, reinterpret_cast<char *>(&root_hash));
   }
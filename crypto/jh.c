@@ -18,6 +18,12 @@
 #include <stdint.h>
 #include <string.h>
 
+/*SSE2 is there on every x86-64 CPU, E8 runs a row of the state per register with it*/
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JH_SSE2
+#include <emmintrin.h>
+#endif
+
 /*typedef unsigned long long uint64;*/
 typedef uint64_t uint64;
 
@@ -45,7 +51,7 @@ const unsigned char JH384_H0[128]={0x48,0x1e,0x3b,0xc6,0xd8,0x13,0x39,0x8a,0x6d,
 const unsigned char JH512_H0[128]={0x6f,0xd1,0x4b,0x96,0x3e,0x0,0xaa,0x17,0x63,0x6a,0x2e,0x5,0x7a,0x15,0xd5,0x43,0x8a,0x22,0x5e,0x8d,0xc,0x97,0xef,0xb,0xe9,0x34,0x12,0x59,0xf2,0xb3,0xc3,0x61,0x89,0x1d,0xa0,0xc1,0x53,0x6f,0x80,0x1e,0x2a,0xa9,0x5,0x6b,0xea,0x2b,0x6d,0x80,0x58,0x8e,0xcc,0xdb,0x20,0x75,0xba,0xa6,0xa9,0xf,0x3a,0x76,0xba,0xf8,0x3b,0xf7,0x1,0x69,0xe6,0x5,0x41,0xe3,0x4a,0x69,0x46,0xb5,0x8a,0x8e,0x2e,0x6f,0xe6,0x5a,0x10,0x47,0xa7,0xd0,0xc1,0x84,0x3c,0x24,0x3b,0x6e,0x71,0xb1,0x2d,0x5a,0xc1,0x99,0xcf,0x57,0xf6,0xec,0x9d,0xb1,0xf8,0x56,0xa7,0x6,0x88,0x7c,0x57,0x16,0xb1,0x56,0xe3,0xc2,0xfc,0xdf,0xe6,0x85,0x17,0xfb,0x54,0x5a,0x46,0x78,0xcc,0x8c,0xdd,0x4b};
 
 /*42 round constants, each round constant is 32-byte (256-bit)*/
-const unsigned char E8_bitslice_roundconstant[42][32]={
+DATA_ALIGN16(const unsigned char E8_bitslice_roundconstant[42][32])={
 {0x72,0xd5,0xde,0xa2,0xdf,0x15,0xf8,0x67,0x7b,0x84,0x15,0xa,0xb7,0x23,0x15,0x57,0x81,0xab,0xd6,0x90,0x4d,0x5a,0x87,0xf6,0x4e,0x9f,0x4f,0xc5,0xc3,0xd1,0x2b,0x40},
 {0xea,0x98,0x3a,0xe0,0x5c,0x45,0xfa,0x9c,0x3,0xc5,0xd2,0x99,0x66,0xb2,0x99,0x9a,0x66,0x2,0x96,0xb4,0xf2,0xbb,0x53,0x8a,0xb5,0x56,0x14,0x1a,0x88,0xdb,0xa2,0x31},
 {0x3,0xa3,0x5a,0x5c,0x9a,0x19,0xe,0xdb,0x40,0x3f,0xb2,0xa,0x87,0xc1,0x44,0x10,0x1c,0x5,0x19,0x80,0x84,0x9e,0x95,0x1d,0x6f,0x33,0xeb,0xad,0x5e,0xe7,0xcd,0xdc},
@@ -149,6 +155,95 @@ HashReturn jh_hash(int hashbitlen, const BitSequence *data,DataLength databitlen
       m2 ^= temp0;                  \
       m6 ^= temp1;
 
+#ifdef JH_SSE2
+
+/*The same layers on the two 64-bit halves of a row at once*/
+#define SWAP1_128(x)   (x) = _mm_or_si128(_mm_slli_epi64(_mm_and_si128((x), _mm_set1_epi32(0x55555555)), 1), _mm_srli_epi64(_mm_and_si128((x), _mm_set1_epi32(0xaaaaaaaa)), 1));
+#define SWAP2_128(x)   (x) = _mm_or_si128(_mm_slli_epi64(_mm_and_si128((x), _mm_set1_epi32(0x33333333)), 2), _mm_srli_epi64(_mm_and_si128((x), _mm_set1_epi32(0xcccccccc)), 2));
+#define SWAP4_128(x)   (x) = _mm_or_si128(_mm_slli_epi64(_mm_and_si128((x), _mm_set1_epi32(0x0f0f0f0f)), 4), _mm_srli_epi64(_mm_and_si128((x), _mm_set1_epi32(0xf0f0f0f0)), 4));
+#define SWAP8_128(x)   (x) = _mm_or_si128(_mm_slli_epi16((x), 8), _mm_srli_epi16((x), 8));
+#define SWAP16_128(x)  (x) = _mm_shufflehi_epi16(_mm_shufflelo_epi16((x), 0xb1), 0xb1);
+#define SWAP32_128(x)  (x) = _mm_shuffle_epi32((x), 0xb1);
+#define SWAP64_128(x)  (x) = _mm_shuffle_epi32((x), 0x4e);
+
+#define L_128(m0,m1,m2,m3,m4,m5,m6,m7) \
+      (m4) = _mm_xor_si128((m4), (m1));                    \
+      (m5) = _mm_xor_si128((m5), (m2));                    \
+      (m6) = _mm_xor_si128((m6), _mm_xor_si128((m0), (m3))); \
+      (m7) = _mm_xor_si128((m7), (m0));                    \
+      (m0) = _mm_xor_si128((m0), (m5));                    \
+      (m1) = _mm_xor_si128((m1), (m6));                    \
+      (m2) = _mm_xor_si128((m2), _mm_xor_si128((m4), (m7))); \
+      (m3) = _mm_xor_si128((m3), (m4));
+
+#define SS_128(m0,m1,m2,m3,m4,m5,m6,m7,cc0,cc1)   \
+      m3  = _mm_xor_si128(m3, ones);                       \
+      m7  = _mm_xor_si128(m7, ones);                       \
+      m0  = _mm_xor_si128(m0, _mm_andnot_si128(m2, cc0));  \
+      m4  = _mm_xor_si128(m4, _mm_andnot_si128(m6, cc1));  \
+      temp0 = _mm_xor_si128(cc0, _mm_and_si128(m0, m1));   \
+      temp1 = _mm_xor_si128(cc1, _mm_and_si128(m4, m5));   \
+      m0  = _mm_xor_si128(m0, _mm_and_si128(m2, m3));      \
+      m4  = _mm_xor_si128(m4, _mm_and_si128(m6, m7));      \
+      m3  = _mm_xor_si128(m3, _mm_andnot_si128(m1, m2));   \
+      m7  = _mm_xor_si128(m7, _mm_andnot_si128(m5, m6));   \
+      m1  = _mm_xor_si128(m1, _mm_and_si128(m0, m2));      \
+      m5  = _mm_xor_si128(m5, _mm_and_si128(m4, m6));      \
+      m2  = _mm_xor_si128(m2, _mm_andnot_si128(m3, m0));   \
+      m6  = _mm_xor_si128(m6, _mm_andnot_si128(m7, m4));   \
+      m0  = _mm_xor_si128(m0, _mm_or_si128(m1, m3));       \
+      m4  = _mm_xor_si128(m4, _mm_or_si128(m5, m7));       \
+      m3  = _mm_xor_si128(m3, _mm_and_si128(m1, m2));      \
+      m7  = _mm_xor_si128(m7, _mm_and_si128(m5, m6));      \
+      m1  = _mm_xor_si128(m1, _mm_and_si128(temp0, m0));   \
+      m5  = _mm_xor_si128(m5, _mm_and_si128(temp1, m4));   \
+      m2  = _mm_xor_si128(m2, temp0);                      \
+      m6  = _mm_xor_si128(m6, temp1);
+
+/*round r: Sbox, MDS and Swapping layers*/
+#define ROUND_128(r, SWAP) \
+      SS_128(x0,x2,x4,x6,x1,x3,x5,x7,_mm_load_si128((const __m128i*)E8_bitslice_roundconstant[r]),_mm_load_si128((const __m128i*)(E8_bitslice_roundconstant[r] + 16))); \
+      L_128(x0,x2,x4,x6,x1,x3,x5,x7);                                 \
+      SWAP(x1); SWAP(x3); SWAP(x5); SWAP(x7);
+
+/*The bijective function E8, in bitslice form, a row of the state to a register*/
+static void E8(hashState *state)
+{
+      __m128i x0,x1,x2,x3,x4,x5,x6,x7,temp0,temp1;
+      const __m128i ones = _mm_set1_epi32(-1);
+      int roundnumber;
+
+      x0 = _mm_load_si128((const __m128i*)state->x[0]);
+      x1 = _mm_load_si128((const __m128i*)state->x[1]);
+      x2 = _mm_load_si128((const __m128i*)state->x[2]);
+      x3 = _mm_load_si128((const __m128i*)state->x[3]);
+      x4 = _mm_load_si128((const __m128i*)state->x[4]);
+      x5 = _mm_load_si128((const __m128i*)state->x[5]);
+      x6 = _mm_load_si128((const __m128i*)state->x[6]);
+      x7 = _mm_load_si128((const __m128i*)state->x[7]);
+
+      for (roundnumber = 0; roundnumber < 42; roundnumber = roundnumber+7) {
+            ROUND_128(roundnumber+0, SWAP1_128);
+            ROUND_128(roundnumber+1, SWAP2_128);
+            ROUND_128(roundnumber+2, SWAP4_128);
+            ROUND_128(roundnumber+3, SWAP8_128);
+            ROUND_128(roundnumber+4, SWAP16_128);
+            ROUND_128(roundnumber+5, SWAP32_128);
+            ROUND_128(roundnumber+6, SWAP64_128);
+      }
+
+      _mm_store_si128((__m128i*)state->x[0], x0);
+      _mm_store_si128((__m128i*)state->x[1], x1);
+      _mm_store_si128((__m128i*)state->x[2], x2);
+      _mm_store_si128((__m128i*)state->x[3], x3);
+      _mm_store_si128((__m128i*)state->x[4], x4);
+      _mm_store_si128((__m128i*)state->x[5], x5);
+      _mm_store_si128((__m128i*)state->x[6], x6);
+      _mm_store_si128((__m128i*)state->x[7], x7);
+}
+
+#else
+
 /*The bijective function E8, in bitslice form*/
 static void E8(hashState *state)
 {
@@ -210,6 +305,8 @@ static void E8(hashState *state)
 
 }
 
+#endif
+
 /*The compression function F8 */
 static void F8(hashState *state)
 {
@@ -0,0 +1,143 @@
+// Copyright (c) 2012-2013 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Built with AVX2 enabled, selected at runtime by hash.c. Runs four Keccak
+// states side by side, lane l of every register belonging to input l.
+
+#include <immintrin.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hash-ops.h"
+#include "keccak.h"
+
+#define ROTL256(x, n) _mm256_or_si256(_mm256_slli_epi64((x), (n)), _mm256_srli_epi64((x), 64 - (n)))
+
+// Turns four rows of four words into the four columns, and back
+static void transpose4(__m256i w[4])
+{
+    __m256i t0 = _mm256_unpacklo_epi64(w[0], w[1]);
+    __m256i t1 = _mm256_unpackhi_epi64(w[0], w[1]);
+    __m256i t2 = _mm256_unpacklo_epi64(w[2], w[3]);
+    __m256i t3 = _mm256_unpackhi_epi64(w[2], w[3]);
+
+    w[0] = _mm256_permute2x128_si256(t0, t2, 0x20);
+    w[1] = _mm256_permute2x128_si256(t1, t3, 0x20);
+    w[2] = _mm256_permute2x128_si256(t0, t2, 0x31);
+    w[3] = _mm256_permute2x128_si256(t1, t3, 0x31);
+}
+
+// keccakf on four states, with the Rho Pi step written out
+static void keccakf_x4(__m256i st[25], int rounds)
+{
+    int i, j, round;
+    __m256i t, bc[5], b[25];
+
+    for (round = 0; round < rounds; round++) {
+
+        // Theta
+        for (i = 0; i < 5; i++)
+            bc[i] = _mm256_xor_si256(_mm256_xor_si256(_mm256_xor_si256(st[i], st[i + 5]), _mm256_xor_si256(st[i + 10], st[i + 15])), st[i + 20]);
+
+        for (i = 0; i < 5; i++) {
+            t = _mm256_xor_si256(bc[(i + 4) % 5], ROTL256(bc[(i + 1) % 5], 1));
+            for (j = 0; j < 25; j += 5)
+                st[j + i] = _mm256_xor_si256(st[j + i], t);
+        }
+
+        // Rho Pi
+        b[0] = st[0];
+        b[1] = ROTL256(st[6], 44);
+        b[2] = ROTL256(st[12], 43);
+        b[3] = ROTL256(st[18], 21);
+        b[4] = ROTL256(st[24], 14);
+        b[5] = ROTL256(st[3], 28);
+        b[6] = ROTL256(st[9], 20);
+        b[7] = ROTL256(st[10], 3);
+        b[8] = ROTL256(st[16], 45);
+        b[9] = ROTL256(st[22], 61);
+        b[10] = ROTL256(st[1], 1);
+        b[11] = ROTL256(st[7], 6);
+        b[12] = ROTL256(st[13], 25);
+        b[13] = ROTL256(st[19], 8);
+        b[14] = ROTL256(st[20], 18);
+        b[15] = ROTL256(st[4], 27);
+        b[16] = ROTL256(st[5], 36);
+        b[17] = ROTL256(st[11], 10);
+        b[18] = ROTL256(st[17], 15);
+        b[19] = ROTL256(st[23], 56);
+        b[20] = ROTL256(st[2], 62);
+        b[21] = ROTL256(st[8], 55);
+        b[22] = ROTL256(st[14], 39);
+        b[23] = ROTL256(st[15], 41);
+        b[24] = ROTL256(st[21], 2);
+
+        //  Chi
+        for (j = 0; j < 25; j += 5)
+            for (i = 0; i < 5; i++)
+                st[j + i] = _mm256_xor_si256(b[j + i], _mm256_andnot_si256(b[j + (i + 1) % 5], b[j + (i + 2) % 5]));
+
+        //  Iota
+        st[0] = _mm256_xor_si256(st[0], _mm256_set1_epi64x((long long) keccakf_rndc[round]));
+    }
+}
+
+// XORs one HASH_DATA_AREA block of every input into its state
+static void absorb_x4(__m256i st[25], const uint8_t *in[4])
+{
+    int i, l;
+    __m256i w[4];
+    uint64_t tail[4];
+
+    for (i = 0; i + 4 <= HASH_DATA_AREA / 8; i += 4) {
+        for (l = 0; l < 4; l++)
+            w[l] = _mm256_loadu_si256((const __m256i *) (in[l] + i * 8));
+        transpose4(w);
+        for (l = 0; l < 4; l++)
+            st[i + l] = _mm256_xor_si256(st[i + l], w[l]);
+    }
+
+    for ( ; i < HASH_DATA_AREA / 8; i++) {
+        for (l = 0; l < 4; l++)
+            memcpy(&tail[l], in[l] + i * 8, 8);
+        st[i] = _mm256_xor_si256(st[i], _mm256_set_epi64x((long long) tail[3], (long long) tail[2], (long long) tail[1], (long long) tail[0]));
+    }
+}
+
+void cn_fast_hash_x4_avx2(const void *data, size_t length, char *hash)
+{
+    __m256i st[25];
+    uint8_t temp[4][HASH_DATA_AREA];
+    const uint8_t *in[4];
+    size_t offset, rest;
+    int i, l;
+
+    for (i = 0; i < 25; i++)
+        st[i] = _mm256_setzero_si256();
+
+    for (offset = 0; length - offset >= HASH_DATA_AREA; offset += HASH_DATA_AREA) {
+        for (l = 0; l < 4; l++)
+            in[l] = (const uint8_t *) data + l * length + offset;
+        absorb_x4(st, in);
+        keccakf_x4(st, KECCAK_ROUNDS);
+    }
+
+    // last block and padding
+    rest = length - offset;
+    for (l = 0; l < 4; l++) {
+        memcpy(temp[l], (const uint8_t *) data + l * length + offset, rest);
+        temp[l][rest] = 1;
+        memset(temp[l] + rest + 1, 0, HASH_DATA_AREA - rest - 1);
+        temp[l][HASH_DATA_AREA - 1] |= 0x80;
+        in[l] = temp[l];
+    }
+    absorb_x4(st, in);
+    keccakf_x4(st, KECCAK_ROUNDS);
+
+    // Every input was read before the first hash is written, so hash may overlap data
+    transpose4(st);
+    for (l = 0; l < 4; l++)
+        _mm256_storeu_si256((__m256i *) (hash + l * HASH_SIZE), st[l]);
+}
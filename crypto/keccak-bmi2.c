@@ -0,0 +1,10 @@
+// Copyright (c) 2012-2013 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Built with BMI and BMI2 enabled, for andn in Chi and rorx in Rho, or with
+// AVX2 on MSVC, selected at runtime by keccak.c
+
+#define KECCAKF_NAME keccakf_bmi2
+#define KECCAKF_ANDN 1
+#include "keccak-kernel.h"
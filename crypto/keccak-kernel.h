@@ -0,0 +1,162 @@
+// keccak-kernel.h
+// Body of an unrolled keccakf. keccak.c and keccak-bmi2.c include it once
+// each, with their own instruction set flags, after defining
+//   KECCAKF_NAME - name of the exported function
+//   KECCAKF_ANDN - 1 to compute Chi as b0 ^ (~b1 & b2), one andn per lane
+//                  with BMI. 0 to keep lanes 1, 2, 8, 12, 17 and 20
+//                  complemented inside the permutation, which leaves five
+//                  NOTs per round instead of 25 on CPUs without andn.
+// Rounds run two at a time, from the state into e and back, so no lane is
+// copied between them.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "keccak.h"
+
+static inline void keccakf_round(const uint64_t a[25], uint64_t e[25], uint64_t rc)
+{
+    uint64_t c0, c1, c2, c3, c4, d0, d1, d2, d3, d4, b0, b1, b2, b3, b4;
+
+    // Theta
+    c0 = a[0] ^ a[5] ^ a[10] ^ a[15] ^ a[20];
+    c1 = a[1] ^ a[6] ^ a[11] ^ a[16] ^ a[21];
+    c2 = a[2] ^ a[7] ^ a[12] ^ a[17] ^ a[22];
+    c3 = a[3] ^ a[8] ^ a[13] ^ a[18] ^ a[23];
+    c4 = a[4] ^ a[9] ^ a[14] ^ a[19] ^ a[24];
+    d0 = c4 ^ ROTL64(c1, 1);
+    d1 = c0 ^ ROTL64(c2, 1);
+    d2 = c1 ^ ROTL64(c3, 1);
+    d3 = c2 ^ ROTL64(c4, 1);
+    d4 = c3 ^ ROTL64(c0, 1);
+
+    // Rho Pi, then Chi and Iota, one row of e at a time
+    b0 = a[0] ^ d0;
+    b1 = ROTL64(a[6] ^ d1, 44);
+    b2 = ROTL64(a[12] ^ d2, 43);
+    b3 = ROTL64(a[18] ^ d3, 21);
+    b4 = ROTL64(a[24] ^ d4, 14);
+#if KECCAKF_ANDN
+    e[0] = b0 ^ (~b1 & b2) ^ rc;
+    e[1] = b1 ^ (~b2 & b3);
+    e[2] = b2 ^ (~b3 & b4);
+    e[3] = b3 ^ (~b4 & b0);
+    e[4] = b4 ^ (~b0 & b1);
+#else
+    e[0] = b0 ^ (b1 | b2) ^ rc;
+    e[1] = b1 ^ (~b2 | b3);
+    e[2] = b2 ^ (b3 & b4);
+    e[3] = b3 ^ (b4 | b0);
+    e[4] = b4 ^ (b0 & b1);
+#endif
+
+    b0 = ROTL64(a[3] ^ d3, 28);
+    b1 = ROTL64(a[9] ^ d4, 20);
+    b2 = ROTL64(a[10] ^ d0, 3);
+    b3 = ROTL64(a[16] ^ d1, 45);
+    b4 = ROTL64(a[22] ^ d2, 61);
+#if KECCAKF_ANDN
+    e[5] = b0 ^ (~b1 & b2);
+    e[6] = b1 ^ (~b2 & b3);
+    e[7] = b2 ^ (~b3 & b4);
+    e[8] = b3 ^ (~b4 & b0);
+    e[9] = b4 ^ (~b0 & b1);
+#else
+    e[5] = b0 ^ (b1 | b2);
+    e[6] = b1 ^ (b2 & b3);
+    e[7] = b2 ^ (b3 | ~b4);
+    e[8] = b3 ^ (b4 | b0);
+    e[9] = b4 ^ (b0 & b1);
+#endif
+
+    b0 = ROTL64(a[1] ^ d1, 1);
+    b1 = ROTL64(a[7] ^ d2, 6);
+    b2 = ROTL64(a[13] ^ d3, 25);
+    b3 = ROTL64(a[19] ^ d4, 8);
+    b4 = ROTL64(a[20] ^ d0, 18);
+#if KECCAKF_ANDN
+    e[10] = b0 ^ (~b1 & b2);
+    e[11] = b1 ^ (~b2 & b3);
+    e[12] = b2 ^ (~b3 & b4);
+    e[13] = b3 ^ (~b4 & b0);
+    e[14] = b4 ^ (~b0 & b1);
+#else
+    e[10] = b0 ^ (b1 | b2);
+    e[11] = b1 ^ (b2 & b3);
+    e[12] = b2 ^ (~b3 & b4);
+    e[13] = ~b3 ^ (b4 | b0);
+    e[14] = b4 ^ (b0 & b1);
+#endif
+
+    b0 = ROTL64(a[4] ^ d4, 27);
+    b1 = ROTL64(a[5] ^ d0, 36);
+    b2 = ROTL64(a[11] ^ d1, 10);
+    b3 = ROTL64(a[17] ^ d2, 15);
+    b4 = ROTL64(a[23] ^ d3, 56);
+#if KECCAKF_ANDN
+    e[15] = b0 ^ (~b1 & b2);
+    e[16] = b1 ^ (~b2 & b3);
+    e[17] = b2 ^ (~b3 & b4);
+    e[18] = b3 ^ (~b4 & b0);
+    e[19] = b4 ^ (~b0 & b1);
+#else
+    e[15] = b0 ^ (b1 & b2);
+    e[16] = b1 ^ (b2 | b3);
+    e[17] = b2 ^ (~b3 | b4);
+    e[18] = ~b3 ^ (b4 & b0);
+    e[19] = b4 ^ (b0 | b1);
+#endif
+
+    b0 = ROTL64(a[2] ^ d2, 62);
+    b1 = ROTL64(a[8] ^ d3, 55);
+    b2 = ROTL64(a[14] ^ d4, 39);
+    b3 = ROTL64(a[15] ^ d0, 41);
+    b4 = ROTL64(a[21] ^ d1, 2);
+#if KECCAKF_ANDN
+    e[20] = b0 ^ (~b1 & b2);
+    e[21] = b1 ^ (~b2 & b3);
+    e[22] = b2 ^ (~b3 & b4);
+    e[23] = b3 ^ (~b4 & b0);
+    e[24] = b4 ^ (~b0 & b1);
+#else
+    e[20] = b0 ^ (~b1 & b2);
+    e[21] = ~b1 ^ (b2 | b3);
+    e[22] = b2 ^ (b3 & b4);
+    e[23] = b3 ^ (b4 | b0);
+    e[24] = b4 ^ (b0 & b1);
+#endif
+}
+
+#if !KECCAKF_ANDN
+static void complement_lanes(uint64_t st[25])
+{
+    st[1] = ~st[1];
+    st[2] = ~st[2];
+    st[8] = ~st[8];
+    st[12] = ~st[12];
+    st[17] = ~st[17];
+    st[20] = ~st[20];
+}
+#endif
+
+void KECCAKF_NAME(uint64_t st[25], int rounds)
+{
+    uint64_t e[25];
+    int round;
+
+#if !KECCAKF_ANDN
+    complement_lanes(st);
+#endif
+    for (round = 0; round + 2 <= rounds; round += 2) {
+        keccakf_round(st, e, keccakf_rndc[round]);
+        keccakf_round(e, st, keccakf_rndc[round + 1]);
+    }
+
+    if (round < rounds) {
+        keccakf_round(st, e, keccakf_rndc[round]);
+        memcpy(st, e, sizeof(e));
+    }
+#if !KECCAKF_ANDN
+    complement_lanes(st);
+#endif
+}
@@ -2,6 +2,7 @@
 // 19-Nov-11  Markku-Juhani O. Saarinen <mjos@iki.fi>
 // A baseline Keccak (3rd round) implementation.
 
+#include "cpu-features.h"
 #include "hash-ops.h"
 #include "keccak.h"
 
@@ -29,9 +30,10 @@ const int keccakf_piln[24] =
     15, 23, 19, 13, 12, 2, 20, 14, 22, 9,  6,  1 
 };
 
-// update the state with given number of rounds
+// update the state with given number of rounds, the baseline the unrolled
+// keccakf_portable and keccakf_bmi2 are tested against
 
-void keccakf(uint64_t st[25], int rounds)
+void keccakf_reference(uint64_t st[25], int rounds)
 {
     int i, j, round;
     uint64_t t, bc[5];
@@ -70,6 +72,30 @@ void keccakf(uint64_t st[25], int rounds)
     }
 }
 
+#define KECCAKF_NAME keccakf_portable
+#define KECCAKF_ANDN 0
+#include "keccak-kernel.h"
+
+// MSVC has no flag for BMI alone, keccak-bmi2.c is built with /arch:AVX2 there
+#if defined(_MSC_VER)
+#define KECCAKF_BMI2_FEATURES (CPU_AVX2 | CPU_BMI | CPU_BMI2)
+#else
+#define KECCAKF_BMI2_FEATURES (CPU_BMI | CPU_BMI2)
+#endif
+
+int keccakf_bmi2_supported(void)
+{
+    return (cpu_features() & KECCAKF_BMI2_FEATURES) == KECCAKF_BMI2_FEATURES;
+}
+
+void keccakf(uint64_t st[25], int rounds)
+{
+    if (keccakf_bmi2_supported())
+        keccakf_bmi2(st, rounds);
+    else
+        keccakf_portable(st, rounds);
+}
+
 // compute a keccak hash (md) of given byte length from "in"
 typedef uint64_t state_t[25];
 
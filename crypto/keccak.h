@@ -15,11 +15,21 @@
 #define ROTL64(x, y) (((x) << (y)) | ((x) >> (64 - (y))))
 #endif
 
+// round constants of keccakf
+extern const uint64_t keccakf_rndc[24];
+
 // compute a keccak hash (md) of given byte length from "in"
 int keccak(const uint8_t *in, int inlen, uint8_t *md, int mdlen);
 
-// update the state
+// update the state, with keccakf_bmi2 where keccakf_bmi2_supported and
+// keccakf_portable elsewhere
 void keccakf(uint64_t st[25], int norounds);
+void keccakf_portable(uint64_t st[25], int norounds);
+void keccakf_bmi2(uint64_t st[25], int norounds);
+int keccakf_bmi2_supported(void);
+
+// the baseline keccakf, for testing the others against
+void keccakf_reference(uint64_t st[25], int norounds);
 
 void keccak1600(const uint8_t *in, int inlen, uint8_t *md);
 
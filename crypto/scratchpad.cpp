@@ -0,0 +1,167 @@
+// Copyright (c) 2012-2013 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "scratchpad.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace crypto {
+
+  namespace {
+
+    struct scratchpad_entry {
+      std::uint8_t *data;
+      std::size_t count;
+      int node;
+      bool used;
+    };
+
+    std::mutex scratchpads_lock;
+    std::vector<scratchpad_entry> scratchpads;
+
+    int current_numa_node() {
+#if defined(_WIN32)
+      UCHAR node;
+      if (GetNumaProcessorNode(static_cast<UCHAR>(GetCurrentProcessorNumber()), &node) && node != 0xff) {
+        return node;
+      }
+#elif defined(__linux__) && defined(SYS_getcpu)
+      unsigned int cpu;
+      unsigned int node;
+      if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0) {
+        return static_cast<int>(node);
+      }
+#endif
+      return 0;
+    }
+
+#if defined(_WIN32)
+
+    std::uint8_t *map_scratchpad(std::size_t size, int node) {
+      void *data = NULL;
+      SIZE_T large_page = GetLargePageMinimum();
+      if (large_page != 0 && size % large_page == 0) {
+        // Needs SeLockMemoryPrivilege, falls back to normal pages without it
+        data = VirtualAllocExNuma(GetCurrentProcess(), NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE, node);
+      }
+
+      if (data == NULL) {
+        data = VirtualAllocExNuma(GetCurrentProcess(), NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, node);
+      }
+
+      return static_cast<std::uint8_t *>(data);
+    }
+
+    void unmap_scratchpad(std::uint8_t *data, std::size_t) {
+      VirtualFree(data, 0, MEM_RELEASE);
+    }
+
+#else
+
+    std::uint8_t *map_scratchpad(std::size_t size, int) {
+      void *data = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+      data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+      if (data != MAP_FAILED) {
+        return static_cast<std::uint8_t *>(data);
+      }
+
+      // No reserved huge pages, align to the huge page size so that transparent huge pages can back the region
+      data = mmap(NULL, size + SCRATCHPAD_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (data == MAP_FAILED) {
+        return NULL;
+      }
+
+      std::uint8_t *mapped = static_cast<std::uint8_t *>(data);
+      std::uint8_t *aligned = reinterpret_cast<std::uint8_t *>((reinterpret_cast<std::uintptr_t>(mapped) + SCRATCHPAD_SIZE - 1) & ~(SCRATCHPAD_SIZE - 1));
+      if (aligned != mapped) {
+        munmap(mapped, aligned - mapped);
+      }
+
+      munmap(aligned + size, mapped + SCRATCHPAD_SIZE - aligned);
+
+#if defined(MADV_HUGEPAGE)
+      madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+      return aligned;
+    }
+
+    void unmap_scratchpad(std::uint8_t *data, std::size_t size) {
+      munmap(data, size);
+    }
+
+#endif
+
+  }
+
+  std::uint8_t *acquire_scratchpad(std::size_t count) {
+    int node = current_numa_node();
+    std::vector<scratchpad_entry> unused;
+    {
+      std::lock_guard<std::mutex> lock(scratchpads_lock);
+      for (scratchpad_entry &entry : scratchpads) {
+        if (!entry.used && entry.count == count && entry.node == node) {
+          entry.used = true;
+          return entry.data;
+        }
+      }
+
+      // None fits, so the free ones are of counts no longer asked for. Unmapping them first hands their
+      // memory and reserved huge pages to the new mapping.
+      for (std::size_t i = 0; i < scratchpads.size();) {
+        if (scratchpads[i].used) {
+          ++i;
+        } else {
+          unused.push_back(scratchpads[i]);
+          scratchpads[i] = scratchpads.back();
+          scratchpads.pop_back();
+        }
+      }
+    }
+
+    for (const scratchpad_entry &entry : unused) {
+      unmap_scratchpad(entry.data, entry.count * SCRATCHPAD_SIZE);
+    }
+
+    std::size_t size = count * SCRATCHPAD_SIZE;
+    std::uint8_t *data = map_scratchpad(size, node);
+    if (data == NULL) {
+      throw std::bad_alloc();
+    }
+
+    // Fault the pages in from the requesting thread, the local allocation policy keeps them on its node
+    memset(data, 0, size);
+
+    scratchpad_entry entry = { data, count, node, true };
+    std::lock_guard<std::mutex> lock(scratchpads_lock);
+    scratchpads.push_back(entry);
+    return data;
+  }
+
+  void release_scratchpad(std::uint8_t *scratchpad) {
+    std::lock_guard<std::mutex> lock(scratchpads_lock);
+    for (scratchpad_entry &entry : scratchpads) {
+      if (entry.data == scratchpad) {
+        entry.used = false;
+        return;
+      }
+    }
+  }
+
+}
@@ -0,0 +1,45 @@
+// Copyright (c) 2012-2013 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace crypto {
+
+  const std::size_t SCRATCHPAD_SIZE = 1 << 21;
+
+  /*
+    Process wide arena of cn_slow_hash scratchpads. Every request gets count
+    contiguous 2MB scratchpads, aligned to 2MB and backed by huge pages when
+    the system allows it, placed on the NUMA node of the requesting thread.
+    Released scratchpads are kept for requests of the same count on the same
+    node. A request none of them fits returns them all to the system before
+    mapping its own, so only counts still asked for stay mapped.
+  */
+  std::uint8_t *acquire_scratchpad(std::size_t count = 1);
+  void release_scratchpad(std::uint8_t *scratchpad);
+
+  class scratchpad {
+  public:
+    explicit scratchpad(std::size_t count = 1) : m_data(acquire_scratchpad(count)) {
+    }
+
+    ~scratchpad() {
+      release_scratchpad(m_data);
+    }
+
+    std::uint8_t *data() const {
+      return m_data;
+    }
+
+  private:
+    scratchpad(const scratchpad &);
+    void operator=(const scratchpad &);
+
+    std::uint8_t *m_data;
+  };
+
+}
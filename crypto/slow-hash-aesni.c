@@ -0,0 +1,9 @@
+// Copyright (c) 2012-2013 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Built with AES-NI enabled, selected at runtime by slow-hash.c
+
+#define CN_KERNEL_NAME cn_slow_hash_aesni
+#define CN_KERNEL_AESNI 1
+#include "slow-hash-kernel.h"
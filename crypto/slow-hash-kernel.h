@@ -0,0 +1,605 @@
+// Copyright (c) 2012-2013 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Body of a cn_slow_hash kernel. Every slow-hash translation unit includes it
+// once, with its own instruction set flags, after defining
+//   CN_KERNEL_NAME  - name of the exported entry point
+//   CN_KERNEL_AESNI - 1 to run the AES rounds on AES-NI, 0 for the aesb tables
+//   CN_KERNEL_VAES  - 256 or 512 to run the explode and implode phases on VAES
+//                     vectors of that many bits, optional, needs CN_KERNEL_AESNI
+//   CN_KERNEL_SSSE3 - 1 to run the AES rounds on SSSE3 byte shuffles instead of
+//                     the aesb tables, optional, without CN_KERNEL_AESNI
+// The entry point gets a copy of the hash loop for every algorithm and number of
+// ways, each with its scratchpad size and iteration count as constants.
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "common/int-util.h"
+#include "hash-ops.h"
+
+#ifndef CN_KERNEL_VAES
+#define CN_KERNEL_VAES 0
+#endif
+#ifndef CN_KERNEL_SSSE3
+#define CN_KERNEL_SSSE3 0
+#endif
+
+#if CN_KERNEL_AESNI
+#include <emmintrin.h>
+#if CN_KERNEL_VAES
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER) || defined(__INTEL_COMPILER)
+#include <intrin.h>
+#else
+#include <wmmintrin.h>
+#endif
+#elif CN_KERNEL_SSSE3
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#else
+#include "aesb.h"
+#endif
+
+#if defined(_MSC_VER) || defined(__INTEL_COMPILER)
+#define INLINE __inline
+#define FORCE_INLINE __forceinline
+#else
+#define INLINE inline
+#define FORCE_INLINE inline __attribute__ ((always_inline))
+#endif
+
+// Scratchpad size and iteration count of the algorithms of enum cn_algorithm
+#define CRYPTONIGHT_MEMORY      (1 << 21)
+#define CRYPTONIGHT_ITER        (1 << 20)
+#define CRYPTONIGHT_LITE_MEMORY (1 << 20)
+#define CRYPTONIGHT_LITE_ITER   (1 << 19)
+#define AES_BLOCK_SIZE  16
+#define AES_KEY_SIZE    32
+#define AES_KEY_ROUNDS  10
+#define INIT_SIZE_BLK   8
+#define INIT_SIZE_BYTE (INIT_SIZE_BLK * AES_BLOCK_SIZE)
+
+#define U64(x) ((uint64_t *) (x))
+#define R128(x) ((__m128i *) (x))
+
+#pragma pack(push, 1)
+union cn_slow_hash_state
+{
+    union hash_state hs;
+    struct
+    {
+        uint8_t k[64];
+        uint8_t init[INIT_SIZE_BYTE];
+    };
+};
+#pragma pack(pop)
+
+#if CN_KERNEL_AESNI
+
+// Runs the 10 rounds over all INIT_SIZE_BLK blocks of text round by round, so
+// that the blocks pipeline through the AES unit. xorBlocks, when set, is
+// XORed into text first.
+static INLINE void pseudo_round_blocks(uint8_t *text, const uint8_t *xorBlocks,
+                                       uint8_t *expandedKey)
+{
+    const __m128i *k = R128(expandedKey);
+    __m128i x[INIT_SIZE_BLK];
+    size_t j, r;
+
+    for(j = 0; j < INIT_SIZE_BLK; j++)
+    {
+        x[j] = _mm_loadu_si128(R128(&text[j * AES_BLOCK_SIZE]));
+        if(xorBlocks)
+            x[j] = _mm_xor_si128(x[j], _mm_loadu_si128(R128(&xorBlocks[j * AES_BLOCK_SIZE])));
+    }
+
+    for(r = 0; r < AES_KEY_ROUNDS; r++)
+        for(j = 0; j < INIT_SIZE_BLK; j++)
+            x[j] = _mm_aesenc_si128(x[j], k[r]);
+
+    for(j = 0; j < INIT_SIZE_BLK; j++)
+        _mm_storeu_si128(R128(&text[j * AES_BLOCK_SIZE]), x[j]);
+}
+
+static INLINE void single_round(const uint8_t *in, uint64_t *out, const uint64_t *key)
+{
+    _mm_storeu_si128(R128(out), _mm_aesenc_si128(_mm_loadu_si128(R128(in)), _mm_loadu_si128(R128(key))));
+}
+
+static INLINE __m128i aesni_expand_step(__m128i key, __m128i assist)
+{
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, assist);
+}
+
+#define aesni_expand_pair(k, i, rcon) \
+    k[i] = aesni_expand_step(k[i - 2], _mm_shuffle_epi32(_mm_aeskeygenassist_si128(k[i - 1], rcon), 0xff)); \
+    k[i + 1] = aesni_expand_step(k[i - 1], _mm_shuffle_epi32(_mm_aeskeygenassist_si128(k[i], 0x00), 0xaa))
+
+// First AES_KEY_ROUNDS round keys of the AES-256 key schedule
+static INLINE void expand_key(const uint8_t *key, uint8_t *expandedKey)
+{
+    __m128i *k = R128(expandedKey);
+
+    k[0] = _mm_loadu_si128(R128(key));
+    k[1] = _mm_loadu_si128(R128(key + AES_BLOCK_SIZE));
+    aesni_expand_pair(k, 2, 0x01);
+    aesni_expand_pair(k, 4, 0x02);
+    aesni_expand_pair(k, 6, 0x04);
+    aesni_expand_pair(k, 8, 0x08);
+}
+
+#else
+
+#if CN_KERNEL_SSSE3
+
+// The AES rounds on byte shuffles, in constant time. Every byte of the state
+// goes from the AES field to GF(16)[t]/(t^2 + t + 9), as the coordinates i and
+// k of i * 2t + k. Its inverse is then found with nothing but 16 entry lookups
+// in the tables of 1/x and 2/x, inv(0) = 0x80 making every lookup of it 0:
+//   io = 1/(1/i + 2/k) + j, jo = 1/(1/j + 2/k) + i, where j = i + k
+// The affine map of SubBytes, without its constant, is a sum of lookups of io
+// and jo, and so is twice it for MixColumns. ShiftRows and the rotations of
+// MixColumns are byte shuffles of the S-box output.
+static const CN_ALIGN16 uint8_t ssse3_tables[][16] =
+{
+    // i of the low and high nibble
+    { 0x00, 0x00, 0x01, 0x01, 0x02, 0x02, 0x03, 0x03, 0x02, 0x02, 0x03, 0x03, 0x00, 0x00, 0x01, 0x01 },
+    { 0x00, 0x08, 0x0f, 0x07, 0x08, 0x00, 0x07, 0x0f, 0x07, 0x0f, 0x08, 0x00, 0x0f, 0x07, 0x00, 0x08 },
+    // k of the low and high nibble
+    { 0x00, 0x01, 0x0c, 0x0d, 0x0d, 0x0c, 0x01, 0x00, 0x07, 0x06, 0x0b, 0x0a, 0x0a, 0x0b, 0x06, 0x07 },
+    { 0x00, 0x06, 0x0d, 0x0b, 0x0e, 0x08, 0x03, 0x05, 0x07, 0x01, 0x0a, 0x0c, 0x09, 0x0f, 0x04, 0x02 },
+    // 1/x and 2/x in GF(16)
+    { 0x80, 0x01, 0x09, 0x0e, 0x0d, 0x0b, 0x07, 0x06, 0x0f, 0x02, 0x0c, 0x05, 0x0a, 0x04, 0x03, 0x08 },
+    { 0x80, 0x02, 0x01, 0x0f, 0x09, 0x05, 0x0e, 0x0c, 0x0d, 0x04, 0x0b, 0x0a, 0x07, 0x08, 0x06, 0x03 },
+    // S-box less 0x63 of io and jo
+    { 0x00, 0xcb, 0xd7, 0xb0, 0x21, 0x8d, 0x67, 0xac, 0x7b, 0x5a, 0xea, 0x3d, 0x46, 0xf6, 0x91, 0x1c },
+    { 0x00, 0x9f, 0x61, 0x16, 0xc2, 0x2a, 0x77, 0xe8, 0x89, 0x4b, 0x5d, 0x3c, 0xb5, 0xa3, 0xd4, 0xfe },
+    // twice that
+    { 0x00, 0x8d, 0xb5, 0x7b, 0x42, 0x01, 0xce, 0x43, 0xf6, 0xb4, 0xcf, 0x7a, 0x8c, 0xf7, 0x39, 0x38 },
+    { 0x00, 0x25, 0xc2, 0x2c, 0x9f, 0x54, 0xee, 0xcb, 0x09, 0x96, 0xba, 0x78, 0x71, 0x5d, 0xb3, 0xe7 },
+    // ShiftRows, followed by a rotation of every column by 0 to 3 bytes
+    {  0,  5, 10, 15,  4,  9, 14,  3,  8, 13,  2,  7, 12,  1,  6, 11 },
+    {  5, 10, 15,  0,  9, 14,  3,  4, 13,  2,  7,  8,  1,  6, 11, 12 },
+    { 10, 15,  0,  5, 14,  3,  4,  9,  2,  7,  8, 13,  6, 11, 12,  1 },
+    { 15,  0,  5, 10,  3,  4,  9, 14,  7,  8, 13,  2, 11, 12,  1,  6 }
+};
+
+#define ssse3_table(n) _mm_load_si128(R128(ssse3_tables[n]))
+#define ssse3_lookup(n, x) _mm_shuffle_epi8(ssse3_table(n), x)
+
+// SubBytes of x less its constant 0x63, and twice that
+static FORCE_INLINE void ssse3_sub_bytes(__m128i x, __m128i *s, __m128i *s2)
+{
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    __m128i lo = _mm_and_si128(x, mask);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(x, 4), mask);
+    __m128i i = _mm_xor_si128(ssse3_lookup(0, lo), ssse3_lookup(1, hi));
+    __m128i k = _mm_xor_si128(ssse3_lookup(2, lo), ssse3_lookup(3, hi));
+    __m128i j = _mm_xor_si128(i, k);
+    __m128i ak = ssse3_lookup(5, k);
+    __m128i io = _mm_xor_si128(ssse3_lookup(4, _mm_xor_si128(ssse3_lookup(4, i), ak)), j);
+    __m128i jo = _mm_xor_si128(ssse3_lookup(4, _mm_xor_si128(ssse3_lookup(4, j), ak)), i);
+
+    *s = _mm_xor_si128(ssse3_lookup(6, io), ssse3_lookup(7, jo));
+    *s2 = _mm_xor_si128(ssse3_lookup(8, io), ssse3_lookup(9, jo));
+}
+
+// The same as _mm_aesenc_si128. MixColumns of the constant 0x63 is 0x63, so it
+// goes in with the key.
+static FORCE_INLINE __m128i ssse3_aesenc(__m128i x, __m128i key)
+{
+    __m128i s, s2, y;
+
+    ssse3_sub_bytes(x, &s, &s2);
+    y = _mm_xor_si128(_mm_shuffle_epi8(s2, ssse3_table(10)), _mm_shuffle_epi8(_mm_xor_si128(s, s2), ssse3_table(11)));
+    y = _mm_xor_si128(y, _mm_xor_si128(_mm_shuffle_epi8(s, ssse3_table(12)), _mm_shuffle_epi8(s, ssse3_table(13))));
+    return _mm_xor_si128(y, _mm_xor_si128(key, _mm_set1_epi8(0x63)));
+}
+
+// Four blocks at a time, round by round, as many as stay in registers next to
+// the temporaries of a round
+static INLINE void pseudo_round_blocks(uint8_t *text, const uint8_t *xorBlocks,
+                                       uint8_t *expandedKey)
+{
+    __m128i k[AES_KEY_ROUNDS];
+    __m128i x0, x1, x2, x3;
+    size_t j, r;
+
+    for(r = 0; r < AES_KEY_ROUNDS; r++)
+        k[r] = _mm_loadu_si128(R128(&expandedKey[r * AES_BLOCK_SIZE]));
+
+    for(j = 0; j < INIT_SIZE_BYTE; j += 4 * AES_BLOCK_SIZE)
+    {
+        x0 = _mm_loadu_si128(R128(&text[j]));
+        x1 = _mm_loadu_si128(R128(&text[j + AES_BLOCK_SIZE]));
+        x2 = _mm_loadu_si128(R128(&text[j + 2 * AES_BLOCK_SIZE]));
+        x3 = _mm_loadu_si128(R128(&text[j + 3 * AES_BLOCK_SIZE]));
+        if(xorBlocks)
+        {
+            x0 = _mm_xor_si128(x0, _mm_loadu_si128(R128(&xorBlocks[j])));
+            x1 = _mm_xor_si128(x1, _mm_loadu_si128(R128(&xorBlocks[j + AES_BLOCK_SIZE])));
+            x2 = _mm_xor_si128(x2, _mm_loadu_si128(R128(&xorBlocks[j + 2 * AES_BLOCK_SIZE])));
+            x3 = _mm_xor_si128(x3, _mm_loadu_si128(R128(&xorBlocks[j + 3 * AES_BLOCK_SIZE])));
+        }
+
+        for(r = 0; r < AES_KEY_ROUNDS; r++)
+        {
+            x0 = ssse3_aesenc(x0, k[r]);
+            x1 = ssse3_aesenc(x1, k[r]);
+            x2 = ssse3_aesenc(x2, k[r]);
+            x3 = ssse3_aesenc(x3, k[r]);
+        }
+
+        _mm_storeu_si128(R128(&text[j]), x0);
+        _mm_storeu_si128(R128(&text[j + AES_BLOCK_SIZE]), x1);
+        _mm_storeu_si128(R128(&text[j + 2 * AES_BLOCK_SIZE]), x2);
+        _mm_storeu_si128(R128(&text[j + 3 * AES_BLOCK_SIZE]), x3);
+    }
+}
+
+static INLINE void single_round(const uint8_t *in, uint64_t *out, const uint64_t *key)
+{
+    _mm_storeu_si128(R128(out), ssse3_aesenc(_mm_loadu_si128(R128(in)), _mm_loadu_si128(R128(key))));
+}
+
+static INLINE uint32_t sub_word(uint32_t w)
+{
+    __m128i s, s2;
+
+    ssse3_sub_bytes(_mm_cvtsi32_si128((int) w), &s, &s2);
+    return (uint32_t) _mm_cvtsi128_si32(s) ^ 0x63636363;
+}
+
+#else
+
+// aesb accesses its blocks as 32-bit words, so every block crosses into it
+// through a byte copy to stay clear of the 64-bit accesses of the main loop
+static INLINE void pseudo_round_blocks(uint8_t *text, const uint8_t *xorBlocks,
+                                       uint8_t *expandedKey)
+{
+    uint8_t in[AES_BLOCK_SIZE];
+    uint8_t out[AES_BLOCK_SIZE];
+    size_t j, w;
+
+    for(j = 0; j < INIT_SIZE_BLK; j++)
+    {
+        memcpy(in, &text[j * AES_BLOCK_SIZE], AES_BLOCK_SIZE);
+        if(xorBlocks)
+            for(w = 0; w < AES_BLOCK_SIZE; w++)
+                in[w] ^= xorBlocks[j * AES_BLOCK_SIZE + w];
+        aesb_pseudo_round(in, out, expandedKey);
+        memcpy(&text[j * AES_BLOCK_SIZE], out, AES_BLOCK_SIZE);
+    }
+}
+
+static INLINE void single_round(const uint8_t *in, uint64_t *out, const uint64_t *key)
+{
+    uint8_t block[AES_BLOCK_SIZE];
+    uint8_t roundKey[AES_BLOCK_SIZE];
+
+    memcpy(roundKey, key, AES_BLOCK_SIZE);
+    memcpy(block, in, AES_BLOCK_SIZE);
+    aesb_single_round(block, block, roundKey);
+    memcpy(out, block, AES_BLOCK_SIZE);
+}
+
+static INLINE uint32_t sub_word(uint32_t w)
+{
+    // Byte 1 of every t_fn[0] entry is the plain S-box value
+    return (t_fn[0][bval(w, 0)] >> 8 & 0xff) |
+           (t_fn[0][bval(w, 1)] & 0xff00) |
+           (t_fn[0][bval(w, 2)] << 8 & 0xff0000) |
+           (t_fn[0][bval(w, 3)] << 16 & 0xff000000);
+}
+
+#endif
+
+static INLINE void expand_key(const uint8_t *key, uint8_t *expandedKey)
+{
+    static const uint8_t rcon[] = { 0x01, 0x02, 0x04, 0x08 };
+    uint32_t *w = (uint32_t *) expandedKey;
+    uint32_t t;
+    size_t i;
+
+    memcpy(w, key, AES_KEY_SIZE);
+    for(i = AES_KEY_SIZE / 4; i < AES_KEY_ROUNDS * AES_BLOCK_SIZE / 4; i++)
+    {
+        t = swap32le(w[i - 1]);
+        if(i % 8 == 0)
+            t = sub_word(t >> 8 | t << 24) ^ rcon[i / 8 - 1];
+        else if(i % 8 == 4)
+            t = sub_word(t);
+        w[i] = w[i - 8] ^ swap32le(t);
+    }
+}
+
+#endif
+
+#if CN_KERNEL_VAES
+
+#if CN_KERNEL_VAES == 512
+typedef __m512i aes_vector;
+#define aes_vector_load(p) _mm512_loadu_si512((const void *) (p))
+#define aes_vector_store(p, x) _mm512_storeu_si512((void *) (p), x)
+#define aes_vector_xor _mm512_xor_si512
+#define aes_vector_enc _mm512_aesenc_epi128
+#define aes_vector_broadcast(p) _mm512_broadcast_i32x4(_mm_load_si128(R128(p)))
+#else
+typedef __m256i aes_vector;
+#define aes_vector_load(p) _mm256_loadu_si256((const __m256i *) (p))
+#define aes_vector_store(p, x) _mm256_storeu_si256((__m256i *) (p), x)
+#define aes_vector_xor _mm256_xor_si256
+#define aes_vector_enc _mm256_aesenc_epi128
+#define aes_vector_broadcast(p) _mm256_broadcastsi128_si256(_mm_load_si128(R128(p)))
+#endif
+
+// Vectors of AES blocks the text of one hash fills
+#define AES_VECTORS (INIT_SIZE_BYTE / sizeof(aes_vector))
+// Vectors encrypted side by side, enough independent chains to cover the latency of aesenc,
+// and the number of ways they make up
+#define AES_CHAINS 8
+#define AES_GROUP_WAYS (AES_CHAINS / AES_VECTORS)
+
+// Chain n is vector n % AES_VECTORS of the text of way l + n / AES_VECTORS. The chains are
+// separate variables rather than an array, so that the compiler keeps them in registers.
+#define CHAINS_DO(op) op(0); op(1); op(2); op(3); op(4); op(5); op(6); op(7)
+#define CHAIN_BLOCK(n, base) (base)[l + (n) / AES_VECTORS][(n) % AES_VECTORS * sizeof(aes_vector)]
+#define CHAIN_LOAD_TEXT(n) if(n < chains) x##n = aes_vector_load(&CHAIN_BLOCK(n, text))
+#define CHAIN_STORE_TEXT(n) if(n < chains) aes_vector_store(&CHAIN_BLOCK(n, text), x##n)
+#define CHAIN_STORE_STATE(n) if(n < chains) aes_vector_store(&CHAIN_BLOCK(n, long_state) + i * INIT_SIZE_BYTE, x##n)
+#define CHAIN_XOR_STATE(n) if(n < chains) x##n = aes_vector_xor(x##n, aes_vector_load(&CHAIN_BLOCK(n, long_state) + i * INIT_SIZE_BYTE))
+#define CHAIN_ROUND(n) if(n < chains) x##n = aes_vector_enc(x##n, k[(n) / AES_VECTORS][r])
+
+static FORCE_INLINE void broadcast_round_keys(struct cn_hash_context *context, const size_t ways, size_t l,
+                                              aes_vector k[AES_GROUP_WAYS][AES_KEY_ROUNDS])
+{
+    size_t j, r;
+
+    for(j = 0; j < ways; j++)
+        for(r = 0; r < AES_KEY_ROUNDS; r++)
+            k[j][r] = aes_vector_broadcast(&context->round_keys[l + j][r * AES_BLOCK_SIZE]);
+}
+
+// The explode phase of ways ways from l on, CN_KERNEL_VAES / 128 AES blocks per instruction
+static FORCE_INLINE void explode_group(struct cn_hash_context *context, const size_t memory, const size_t ways, size_t l,
+                                       uint8_t text[][INIT_SIZE_BYTE], uint8_t *long_state[])
+{
+    const size_t chains = ways * AES_VECTORS;
+    aes_vector k[AES_GROUP_WAYS][AES_KEY_ROUNDS];
+    aes_vector x0, x1, x2, x3, x4, x5, x6, x7;
+    size_t i, r;
+
+    broadcast_round_keys(context, ways, l, k);
+    CHAINS_DO(CHAIN_LOAD_TEXT);
+    for(i = 0; i < memory / INIT_SIZE_BYTE; i++)
+    {
+        for(r = 0; r < AES_KEY_ROUNDS; r++)
+        {
+            CHAINS_DO(CHAIN_ROUND);
+        }
+
+        CHAINS_DO(CHAIN_STORE_STATE);
+    }
+}
+
+// The implode phase, with the scratchpad XORed in by the load that brings it in
+static FORCE_INLINE void implode_group(struct cn_hash_context *context, const size_t memory, const size_t ways, size_t l,
+                                       uint8_t text[][INIT_SIZE_BYTE], uint8_t *long_state[])
+{
+    const size_t chains = ways * AES_VECTORS;
+    aes_vector k[AES_GROUP_WAYS][AES_KEY_ROUNDS];
+    aes_vector x0, x1, x2, x3, x4, x5, x6, x7;
+    size_t i, r;
+
+    broadcast_round_keys(context, ways, l, k);
+    CHAINS_DO(CHAIN_LOAD_TEXT);
+    for(i = 0; i < memory / INIT_SIZE_BYTE; i++)
+    {
+        CHAINS_DO(CHAIN_XOR_STATE);
+        for(r = 0; r < AES_KEY_ROUNDS; r++)
+        {
+            CHAINS_DO(CHAIN_ROUND);
+        }
+    }
+
+    CHAINS_DO(CHAIN_STORE_TEXT);
+}
+
+// Whole groups first, then the ways left, so that every group size is a constant
+static FORCE_INLINE void explode_scratchpads(struct cn_hash_context *context, const size_t memory, const size_t ways,
+                                             uint8_t text[][INIT_SIZE_BYTE], uint8_t *long_state[])
+{
+    size_t l;
+
+    for(l = 0; l + AES_GROUP_WAYS <= ways; l += AES_GROUP_WAYS)
+        explode_group(context, memory, AES_GROUP_WAYS, l, text, long_state);
+    if(ways % AES_GROUP_WAYS)
+        explode_group(context, memory, ways % AES_GROUP_WAYS, ways - ways % AES_GROUP_WAYS, text, long_state);
+}
+
+static FORCE_INLINE void implode_scratchpads(struct cn_hash_context *context, const size_t memory, const size_t ways,
+                                             uint8_t text[][INIT_SIZE_BYTE], uint8_t *long_state[])
+{
+    size_t l;
+
+    for(l = 0; l + AES_GROUP_WAYS <= ways; l += AES_GROUP_WAYS)
+        implode_group(context, memory, AES_GROUP_WAYS, l, text, long_state);
+    if(ways % AES_GROUP_WAYS)
+        implode_group(context, memory, ways % AES_GROUP_WAYS, ways - ways % AES_GROUP_WAYS, text, long_state);
+}
+
+#else
+
+// Fills the scratchpads with the text encrypted over and over, 128 bytes at a time
+static FORCE_INLINE void explode_scratchpads(struct cn_hash_context *context, const size_t memory, const size_t ways,
+                                             uint8_t text[][INIT_SIZE_BYTE], uint8_t *long_state[])
+{
+    size_t i, l;
+
+    for(i = 0; i < memory / INIT_SIZE_BYTE; i++)
+    {
+        for(l = 0; l < ways; l++)
+        {
+            pseudo_round_blocks(text[l], NULL, context->round_keys[l]);
+            memcpy(&long_state[l][i * INIT_SIZE_BYTE], text[l], INIT_SIZE_BYTE);
+        }
+    }
+}
+
+// Folds the scratchpads into the text, XORing in 128 bytes ahead of every encryption
+static FORCE_INLINE void implode_scratchpads(struct cn_hash_context *context, const size_t memory, const size_t ways,
+                                             uint8_t text[][INIT_SIZE_BYTE], uint8_t *long_state[])
+{
+    size_t i, l;
+
+    for(i = 0; i < memory / INIT_SIZE_BYTE; i++)
+    {
+        for(l = 0; l < ways; l++)
+            pseudo_round_blocks(text[l], &long_state[l][i * INIT_SIZE_BYTE], context->round_keys[l]);
+    }
+}
+
+#endif
+
+// Offset of the block of the scratchpad a 64-bit word of the state points to
+static FORCE_INLINE size_t state_index(uint64_t x, const size_t memory)
+{
+    return (size_t) x & (memory - AES_BLOCK_SIZE);
+}
+
+// Computes ways independent hashes with their scratchpad walks interleaved, so
+// that the memory latency of one lane is hidden behind the work of the others.
+// Inlined with a constant scratchpad size, iteration count and ways into the
+// entry point below, so that every copy has its own constant loop bounds and masks.
+static FORCE_INLINE void cn_slow_hash_ways(struct cn_hash_context *context, const size_t memory,
+                                           const size_t iterations, const size_t ways,
+                                           const uint8_t *data, size_t length, char *hash)
+{
+    union cn_slow_hash_state state[CN_MAX_WAYS];
+    uint8_t text[CN_MAX_WAYS][INIT_SIZE_BYTE];
+    uint64_t a[CN_MAX_WAYS][2];
+    uint64_t b[CN_MAX_WAYS][2];
+    uint64_t c[CN_MAX_WAYS][2];
+    uint8_t *long_state[CN_MAX_WAYS];
+    uint64_t hi, lo, d0, d1;
+
+    size_t i, l;
+    uint8_t *p = NULL;
+
+    static void (*const extra_hashes[4])(const void *, size_t, char *) =
+    {
+        hash_extra_blake, hash_extra_groestl, hash_extra_jh, hash_extra_skein
+    };
+
+    for(l = 0; l < ways; l++)
+    {
+        long_state[l] = context->long_state + l * memory;
+        hash_process(&state[l].hs, data + l * length, length);
+        memcpy(text[l], state[l].init, INIT_SIZE_BYTE);
+        expand_key(state[l].hs.b, context->round_keys[l]);
+    }
+
+    explode_scratchpads(context, memory, ways, text, long_state);
+
+    for(l = 0; l < ways; l++)
+    {
+        a[l][0] = U64(&state[l].k[0])[0] ^ U64(&state[l].k[32])[0];
+        a[l][1] = U64(&state[l].k[0])[1] ^ U64(&state[l].k[32])[1];
+        b[l][0] = U64(&state[l].k[16])[0] ^ U64(&state[l].k[48])[0];
+        b[l][1] = U64(&state[l].k[16])[1] ^ U64(&state[l].k[48])[1];
+    }
+
+    for(i = 0; i < iterations / 2; i++)
+    {
+        // Iteration 1: c = AES(scratchpad[a], a), scratchpad[a] = b ^ c, b = c
+        for(l = 0; l < ways; l++)
+        {
+            p = &long_state[l][state_index(a[l][0], memory)];
+
+            single_round(p, c[l], a[l]);
+
+            U64(p)[0] = b[l][0] ^ c[l][0];
+            U64(p)[1] = b[l][1] ^ c[l][1];
+            b[l][0] = c[l][0];
+            b[l][1] = c[l][1];
+        }
+
+        // Iteration 2: a += c * scratchpad[c], scratchpad[c] = a, a ^= old scratchpad[c]
+        for(l = 0; l < ways; l++)
+        {
+            p = &long_state[l][state_index(c[l][0], memory)];
+
+            d0 = U64(p)[0];
+            d1 = U64(p)[1];
+            lo = mul128(c[l][0], d0, &hi);
+            a[l][0] += hi;
+            a[l][1] += lo;
+            U64(p)[0] = a[l][0];
+            U64(p)[1] = a[l][1];
+            a[l][0] ^= d0;
+            a[l][1] ^= d1;
+        }
+    }
+
+    for(l = 0; l < ways; l++)
+    {
+        memcpy(text[l], state[l].init, INIT_SIZE_BYTE);
+        expand_key(&state[l].hs.b[32], context->round_keys[l]);
+    }
+
+    implode_scratchpads(context, memory, ways, text, long_state);
+
+    for(l = 0; l < ways; l++)
+    {
+        memcpy(state[l].init, text[l], INIT_SIZE_BYTE);
+        hash_permutation(&state[l].hs);
+        extra_hashes[state[l].hs.b[0] & 3](&state[l], 200, hash + l * HASH_SIZE);
+    }
+}
+
+static FORCE_INLINE void cn_slow_hash_algorithm(struct cn_hash_context *context, const size_t memory,
+                                                const size_t iterations, size_t ways,
+                                                const void *data, size_t length, char *hash)
+{
+    switch(ways)
+    {
+    case 1:
+        cn_slow_hash_ways(context, memory, iterations, 1, data, length, hash);
+        break;
+    case 2:
+        cn_slow_hash_ways(context, memory, iterations, 2, data, length, hash);
+        break;
+    case 3:
+        cn_slow_hash_ways(context, memory, iterations, 3, data, length, hash);
+        break;
+    case 4:
+        cn_slow_hash_ways(context, memory, iterations, 4, data, length, hash);
+        break;
+    default:
+        assert(0);
+    }
+}
+
+void CN_KERNEL_NAME(struct cn_hash_context *context, enum cn_algorithm algorithm, size_t ways,
+                    const void *data, size_t length, char *hash)
+{
+    switch(algorithm)
+    {
+    case CN_ALGORITHM_CRYPTONIGHT:
+        cn_slow_hash_algorithm(context, CRYPTONIGHT_MEMORY, CRYPTONIGHT_ITER, ways, data, length, hash);
+        break;
+    case CN_ALGORITHM_CRYPTONIGHT_LITE:
+        cn_slow_hash_algorithm(context, CRYPTONIGHT_LITE_MEMORY, CRYPTONIGHT_LITE_ITER, ways, data, length, hash);
+        break;
+    default:
+        assert(0);
+    }
+}
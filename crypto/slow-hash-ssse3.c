@@ -0,0 +1,11 @@
+// Copyright (c) 2012-2013 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Built with SSSE3 enabled, selected at runtime by slow-hash.c. The AES rounds
+// run on byte shuffles, for CPUs without AES-NI or VMs that hide it.
+
+#define CN_KERNEL_NAME cn_slow_hash_ssse3
+#define CN_KERNEL_AESNI 0
+#define CN_KERNEL_SSSE3 1
+#include "slow-hash-kernel.h"
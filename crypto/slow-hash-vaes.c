@@ -0,0 +1,11 @@
+// Copyright (c) 2012-2013 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Built with AES-NI, AVX2, BMI2 and VAES enabled, selected at runtime by slow-hash.c.
+// The avx2 kernel with the scratchpad explode and implode on two AES blocks per instruction.
+
+#define CN_KERNEL_NAME cn_slow_hash_vaes
+#define CN_KERNEL_AESNI 1
+#define CN_KERNEL_VAES 256
+#include "slow-hash-kernel.h"
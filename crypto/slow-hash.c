@@ -2,55 +2,38 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
-#include <assert.h>
-#include <stddef.h>
-#include <stdint.h>
-#include <string.h>
+// Portable kernel and the runtime selection between the cn_slow_hash kernels.
+// The instruction set specific kernels live in their own translation units,
+// built with the flags they need, and only run once cpuid allows them.
 
-#include "aesb.h"
-#include "common/int-util.h"
-#include "hash-ops.h"
-#include "oaes_lib.h"
+#include "cpu-features.h"
 
-#include <emmintrin.h>
+#define CN_KERNEL_NAME cn_slow_hash_portable
+#define CN_KERNEL_AESNI 0
+#include "slow-hash-kernel.h"
 
 #if defined(_MSC_VER) || defined(__INTEL_COMPILER)
 #include <intrin.h>
-#define STATIC
-#define INLINE __inline
-#if !defined(RDATA_ALIGN16)
-#define RDATA_ALIGN16 __declspec(align(16))
 #endif
-#else
-#include <wmmintrin.h>
-#define STATIC static
-#define INLINE inline
-#if !defined(RDATA_ALIGN16)
-#define RDATA_ALIGN16 __attribute__ ((aligned(16)))
+
+void cn_slow_hash_ssse3(struct cn_hash_context *context, enum cn_algorithm algorithm, size_t ways, const void *data, size_t length, char *hash);
+void cn_slow_hash_aesni(struct cn_hash_context *context, enum cn_algorithm algorithm, size_t ways, const void *data, size_t length, char *hash);
+void cn_slow_hash_avx2(struct cn_hash_context *context, enum cn_algorithm algorithm, size_t ways, const void *data, size_t length, char *hash);
+#ifdef HAVE_VAES
+void cn_slow_hash_vaes(struct cn_hash_context *context, enum cn_algorithm algorithm, size_t ways, const void *data, size_t length, char *hash);
 #endif
+#ifdef HAVE_VAES512
+void cn_slow_hash_vaes512(struct cn_hash_context *context, enum cn_algorithm algorithm, size_t ways, const void *data, size_t length, char *hash);
 #endif
 
-#define MEMORY         (1 << 21) // 2MB scratchpad
-#define ITER           (1 << 20)
-#define AES_BLOCK_SIZE  16
-#define AES_KEY_SIZE    32
-#define INIT_SIZE_BLK   8
-#define INIT_SIZE_BYTE (INIT_SIZE_BLK * AES_BLOCK_SIZE)
-
-#define U64(x) ((uint64_t *) (x))
-#define R128(x) ((__m128i *) (x))
-
-#pragma pack(push, 1)
-union cn_slow_hash_state
-{
-    union hash_state hs;
-    struct
-    {
-        uint8_t k[64];
-        uint8_t init[INIT_SIZE_BYTE];
-    };
-};
-#pragma pack(pop)
+// The cached CPU features and the selected kernel are read by every hashing thread
+// while another one may set them. MSVC compiles C without _Atomic, but its volatile
+// accesses of aligned words are atomic on x86, with acquire and release semantics.
+#if defined(_MSC_VER)
+#define ATOMIC volatile
+#else
+#define ATOMIC _Atomic
+#endif
 
 #if defined(_MSC_VER) || defined(__INTEL_COMPILER)
 #define cpuid(info,x)    __cpuidex(info,x,0)
@@ -69,189 +52,146 @@ void cpuid(int CPUInfo[4], int InfoType)
 }
 #endif
 
-STATIC INLINE void mul(const uint8_t *a, const uint8_t *b, uint8_t *res)
+// AVX registers are only usable when the OS saves them on context switches,
+// the state bits are XMM and YMM, plus the opmask and both halves of ZMM for AVX-512
+static int check_xsave_state(uint32_t state)
 {
-    uint64_t a0, b0;
-    uint64_t hi, lo;
-
-    a0 = U64(a)[0];
-    b0 = U64(b)[0];
-    lo = mul128(a0, b0, &hi);
-    U64(res)[0] = hi;
-    U64(res)[1] = lo;
+#if defined(_MSC_VER) || defined(__INTEL_COMPILER)
+    return (_xgetbv(0) & state) == state;
+#else
+    uint32_t eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+    return (eax & state) == state;
+#endif
 }
 
-STATIC INLINE void sum_half_blocks(uint8_t *a, const uint8_t *b)
+int cpu_features(void)
 {
-    uint64_t a0, a1, b0, b1;
-    a0 = U64(a)[0];
-    a1 = U64(a)[1];
-    b0 = U64(b)[0];
-    b1 = U64(b)[1];
-    a0 += b0;
-    a1 += b1;
-    U64(a)[0] = a0;
-    U64(a)[1] = a1;
-}
+    int cpuid_results[4];
+    int max_leaf;
+    int result;
+    static ATOMIC int features = -1;
+
+    result = features;
+    if(result >= 0)
+        return result;
+
+    cpuid(cpuid_results, 0);
+    max_leaf = cpuid_results[0];
+    cpuid(cpuid_results, 1);
+    result = 0;
+    if(cpuid_results[2] & (1 << 9))
+        result |= CPU_SSSE3;
+    if(cpuid_results[2] & (1 << 25))
+        result |= CPU_AES;
+    if((cpuid_results[2] & (1 << 27)) && check_xsave_state(0x06) && max_leaf >= 7)
+    {
+        cpuid(cpuid_results, 7);
+        if(cpuid_results[1] & (1 << 3))
+            result |= CPU_BMI;
+        if(cpuid_results[1] & (1 << 5))
+            result |= CPU_AVX2;
+        if(cpuid_results[1] & (1 << 8))
+            result |= CPU_BMI2;
+        if((cpuid_results[1] & (1 << 16)) && check_xsave_state(0xe6))
+            result |= CPU_AVX512F;
+        if(cpuid_results[2] & (1 << 9))
+            result |= CPU_VAES;
+    }
 
-STATIC INLINE void swap_blocks(uint8_t *a, uint8_t *b)
-{
-    uint64_t t[2];
-    U64(t)[0] = U64(a)[0];
-    U64(t)[1] = U64(a)[1];
-    U64(a)[0] = U64(b)[0];
-    U64(a)[1] = U64(b)[1];
-    U64(b)[0] = U64(t)[0];
-    U64(b)[1] = U64(t)[1];
+    // Threads racing here all store the same value
+    features = result;
+    return result;
 }
 
-STATIC INLINE void xor_blocks(uint8_t *a, const uint8_t *b)
+static const struct
 {
-    U64(a)[0] ^= U64(b)[0];
-    U64(a)[1] ^= U64(b)[1];
-}
-
-STATIC INLINE int check_aes_hw(void)
+    const char *name;
+    void (*hash)(struct cn_hash_context *, enum cn_algorithm, size_t, const void *, size_t, char *);
+    int features;
+} kernels[] =
 {
-    int cpuid_results[4];
-    static int supported = -1;
+    { "portable", cn_slow_hash_portable, 0 },
+    { "ssse3", cn_slow_hash_ssse3, CPU_SSSE3 },
+    { "aes-ni", cn_slow_hash_aesni, CPU_AES },
+    { "avx2", cn_slow_hash_avx2, CPU_AES | CPU_AVX2 | CPU_BMI2 },
+#ifdef HAVE_VAES
+    { "vaes", cn_slow_hash_vaes, CPU_AES | CPU_AVX2 | CPU_BMI2 | CPU_VAES },
+#endif
+#ifdef HAVE_VAES512
+    { "vaes-512", cn_slow_hash_vaes512, CPU_AES | CPU_AVX2 | CPU_BMI2 | CPU_VAES | CPU_AVX512F }
+#endif
+};
 
-    if(supported >= 0)
-        return supported;
+#define KERNEL_COUNT (sizeof(kernels) / sizeof(kernels[0]))
 
-    cpuid(cpuid_results,1);
-    return supported = cpuid_results[2] & (1 << 25);
-}
+// KERNEL_COUNT until a kernel is selected
+static ATOMIC size_t selected_kernel = KERNEL_COUNT;
 
-STATIC INLINE void aesni_pseudo_round(const uint8_t *in, uint8_t *out,
-                                      const uint8_t *expandedKey)
+size_t cn_slow_hash_kernel_count(void)
 {
-    __m128i *k = R128(expandedKey);
-    __m128i d;
-
-    d = _mm_loadu_si128(R128(in));
-    d = _mm_aesenc_si128(d, *R128(&k[0]));
-    d = _mm_aesenc_si128(d, *R128(&k[1]));
-    d = _mm_aesenc_si128(d, *R128(&k[2]));
-    d = _mm_aesenc_si128(d, *R128(&k[3]));
-    d = _mm_aesenc_si128(d, *R128(&k[4]));
-    d = _mm_aesenc_si128(d, *R128(&k[5]));
-    d = _mm_aesenc_si128(d, *R128(&k[6]));
-    d = _mm_aesenc_si128(d, *R128(&k[7]));
-    d = _mm_aesenc_si128(d, *R128(&k[8]));
-    d = _mm_aesenc_si128(d, *R128(&k[9]));
-    _mm_storeu_si128((R128(out)), d);
+    return KERNEL_COUNT;
 }
 
-void cn_slow_hash(const void *data, size_t length, char *hash, uint8_t* long_state)
+const char *cn_slow_hash_kernel_name(size_t kernel)
 {
-    uint8_t text[INIT_SIZE_BYTE];
-    uint8_t a[AES_BLOCK_SIZE];
-    uint8_t b[AES_BLOCK_SIZE];
-    uint8_t d[AES_BLOCK_SIZE];
-    RDATA_ALIGN16 uint8_t expandedKey[256];
-
-    union cn_slow_hash_state state;
-
-    size_t i, j;
-    uint8_t *p = NULL;
-    oaes_ctx *aes_ctx;
-
-    int useAes = check_aes_hw();
-    static void (*const extra_hashes[4])(const void *, size_t, char *) =
-    {
-        hash_extra_blake, hash_extra_groestl, hash_extra_jh, hash_extra_skein
-    };
+    assert(kernel < KERNEL_COUNT);
+    return kernels[kernel].name;
+}
 
-    hash_process(&state.hs, data, length);
-    memcpy(text, state.init, INIT_SIZE_BYTE);
+bool cn_slow_hash_kernel_supported(size_t kernel)
+{
+    assert(kernel < KERNEL_COUNT);
+    return (cpu_features() & kernels[kernel].features) == kernels[kernel].features;
+}
 
-    aes_ctx = (oaes_ctx *) oaes_alloc();
-    oaes_key_import_data(aes_ctx, state.hs.b, AES_KEY_SIZE);
+void cn_slow_hash_kernel(size_t kernel, struct cn_hash_context *context, enum cn_algorithm algorithm, size_t ways, const void *data, size_t length, char *hash)
+{
+    assert(cn_slow_hash_kernel_supported(kernel));
+    kernels[kernel].hash(context, algorithm, ways, data, length, hash);
+}
 
-    // use aligned data
-    memcpy(expandedKey, aes_ctx->key->exp_data, aes_ctx->key->exp_data_len);
+size_t cn_slow_hash_selected_kernel(void)
+{
+    size_t kernel = selected_kernel;
 
-    if(useAes)
+    if(kernel == KERNEL_COUNT)
     {
-        for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
-        {
-            for(j = 0; j < INIT_SIZE_BLK; j++)
-                aesni_pseudo_round(&text[AES_BLOCK_SIZE * j], &text[AES_BLOCK_SIZE * j], expandedKey);
-            memcpy(&long_state[i * INIT_SIZE_BYTE], text, INIT_SIZE_BYTE);
-        }
+        // Until told otherwise, the last supported kernel of the table. Not stored, so
+        // that it can never overwrite a kernel another thread selects meanwhile.
+        kernel = KERNEL_COUNT - 1;
+        while(!cn_slow_hash_kernel_supported(kernel))
+            kernel--;
     }
-    else
-    {
-        for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
-        {
-            for(j = 0; j < INIT_SIZE_BLK; j++)
-                aesb_pseudo_round(&text[AES_BLOCK_SIZE * j], &text[AES_BLOCK_SIZE * j], expandedKey);
 
-            memcpy(&long_state[i * INIT_SIZE_BYTE], text, INIT_SIZE_BYTE);
-        }
-    }
-
-    U64(a)[0] = U64(&state.k[0])[0] ^ U64(&state.k[32])[0];
-    U64(a)[1] = U64(&state.k[0])[1] ^ U64(&state.k[32])[1];
-    U64(b)[0] = U64(&state.k[16])[0] ^ U64(&state.k[48])[0];
-    U64(b)[1] = U64(&state.k[16])[1] ^ U64(&state.k[48])[1];
-
-    for(i = 0; i < ITER / 2; i++)
-    {
-				#define TOTALBLOCKS (MEMORY / AES_BLOCK_SIZE)
-				#define state_index(x) (((*((uint64_t *)x) >> 4) & (TOTALBLOCKS - 1)) << 4)
-
-        // Iteration 1
-        p = &long_state[state_index(a)];
+    return kernel;
+}
 
-        if(useAes)
-            _mm_storeu_si128(R128(p), _mm_aesenc_si128(_mm_loadu_si128(R128(p)), _mm_loadu_si128(R128(a))));
-        else
-            aesb_single_round(p, p, a);
+void cn_slow_hash_select_kernel(size_t kernel)
+{
+    assert(cn_slow_hash_kernel_supported(kernel));
+    selected_kernel = kernel;
+}
 
-        xor_blocks(b, p);
-        swap_blocks(b, p);
-        swap_blocks(a, b);
+void cn_hash_context_init(struct cn_hash_context *context, uint8_t *long_state)
+{
+    context->long_state = long_state;
+}
 
-        // Iteration 2
-        p = &long_state[state_index(a)];
+void cn_slow_hash(const void *data, size_t length, char *hash, uint8_t* long_state)
+{
+    struct cn_hash_context context;
 
-        mul(a, p, d);
-        sum_half_blocks(b, d);
-        swap_blocks(b, p);
-        xor_blocks(b, p);
-        swap_blocks(a, b);
-    }
+    cn_hash_context_init(&context, long_state);
+    cn_slow_hash_ctx(&context, data, length, hash);
+}
 
-    memcpy(text, state.init, INIT_SIZE_BYTE);
-    oaes_key_import_data(aes_ctx, &state.hs.b[32], AES_KEY_SIZE);
-    memcpy(expandedKey, aes_ctx->key->exp_data, aes_ctx->key->exp_data_len);
-    if(useAes)
-    {
-        for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
-        {
-            for(j = 0; j < INIT_SIZE_BLK; j++)
-            {
-                xor_blocks(&text[j * AES_BLOCK_SIZE], &long_state[i * INIT_SIZE_BYTE + j * AES_BLOCK_SIZE]);
-                aesni_pseudo_round(&text[j * AES_BLOCK_SIZE], &text[j * AES_BLOCK_SIZE], expandedKey);
-            }
-        }
-    }
-    else
-    {
-        for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
-        {
-            for(j = 0; j < INIT_SIZE_BLK; j++)
-            {
-                xor_blocks(&text[j * AES_BLOCK_SIZE], &long_state[i * INIT_SIZE_BYTE + j * AES_BLOCK_SIZE]);
-                aesb_pseudo_round(&text[AES_BLOCK_SIZE * j], &text[AES_BLOCK_SIZE * j], expandedKey);
-            }
-        }
-    }
+void cn_slow_hash_ctx(struct cn_hash_context *context, const void *data, size_t length, char *hash)
+{
+    kernels[cn_slow_hash_selected_kernel()].hash(context, CN_ALGORITHM_CRYPTONIGHT, 1, data, length, hash);
+}
 
-    oaes_free((OAES_CTX **) &aes_ctx);
-    memcpy(state.init, text, INIT_SIZE_BYTE);
-    hash_permutation(&state.hs);
-    extra_hashes[state.hs.b[0] & 3](&state, 200, hash);
+void cn_slow_hash_multi(struct cn_hash_context *context, enum cn_algorithm algorithm, size_t ways, const void *data, size_t length, char *hash)
+{
+    kernels[cn_slow_hash_selected_kernel()].hash(context, algorithm, ways, data, length, hash);
 }
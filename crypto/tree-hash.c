@@ -2,13 +2,65 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
-#include <alloca.h>
 #include <assert.h>
 #include <stddef.h>
 #include <string.h>
 
 #include "hash-ops.h"
 
+/* Nodes of a level hashed per subtree_hash step, a power of two */
+#define TREE_CHUNK 64
+
+/* Hashes the count pairs of nodes from pairs on into nodes, four at a time. nodes may be pairs, as every
+ * batch is read before it is written and lands below the pairs still to come. */
+static void hash_pairs(const char (*pairs)[HASH_SIZE], size_t count, char (*nodes)[HASH_SIZE]) {
+  size_t i;
+  for (i = 0; i + 4 <= count; i += 4) {
+    cn_fast_hash_x4(pairs[2 * i], 2 * HASH_SIZE, nodes[i]);
+  }
+  for (; i < count; ++i) {
+    cn_fast_hash(pairs[2 * i], 2 * HASH_SIZE, nodes[i]);
+  }
+}
+
+/* The tree is perfect from the level of cnt nodes up, cnt being a power of two. The first 2 * cnt - count
+ * leaves are nodes of that level as they are, the remaining ones are hashed in pairs into the others. */
+static void level_nodes(const char (*hashes)[HASH_SIZE], size_t count, size_t cnt, size_t begin, size_t size, char (*nodes)[HASH_SIZE]) {
+  size_t single = 2 * cnt - count;
+  size_t copied = begin < single ? (single - begin < size ? single - begin : size) : 0;
+  memcpy(nodes, hashes[begin], copied * HASH_SIZE);
+  if (copied < size) {
+    hash_pairs(hashes + 2 * (begin + copied) - single, size - copied, nodes + copied);
+  }
+}
+
+/* Root of the subtree over the size nodes of the level from begin on, size being a power of two. The level
+ * is taken TREE_CHUNK nodes at a time and hashed up to one node a level at a time, so that the hashes of a
+ * level go four at a time. The chunk roots are folded in as they come, with one pending node per height,
+ * so that the scratch space does not grow with the tree. */
+static void subtree_hash(const char (*hashes)[HASH_SIZE], size_t count, size_t cnt, size_t begin, size_t size, char *root_hash) {
+  char pending[sizeof(size_t) << 3][HASH_SIZE];
+  char nodes[TREE_CHUNK][HASH_SIZE];
+  size_t chunk = size < TREE_CHUNK ? size : TREE_CHUNK;
+  size_t i, n, height;
+  assert(size > 0 && (size & (size - 1)) == 0);
+  for (i = 0; i < size / chunk; ++i) {
+    level_nodes(hashes, count, cnt, begin + i * chunk, chunk, nodes);
+    for (n = chunk; n > 1; n >>= 1) {
+      hash_pairs((const char (*)[HASH_SIZE]) nodes, n >> 1, nodes);
+    }
+    for (height = 0; (i >> height) & 1; ++height) {
+      memcpy(nodes[1], nodes[0], HASH_SIZE);
+      memcpy(nodes[0], pending[height], HASH_SIZE);
+      cn_fast_hash(nodes, 2 * HASH_SIZE, nodes[0]);
+    }
+    memcpy(pending[height], nodes[0], HASH_SIZE);
+  }
+  for (height = 0; (size_t) chunk << height < size; ++height) {
+  }
+  memcpy(root_hash, pending[height], HASH_SIZE);
+}
+
 void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash) {
   assert(count > 0);
   if (count == 1) {
@@ -16,26 +68,13 @@ void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash) {
   } else if (count == 2) {
     cn_fast_hash(hashes, 2 * HASH_SIZE, root_hash);
   } else {
-    size_t i, j;
+    size_t i;
     size_t cnt = count - 1;
-    char (*ints)[HASH_SIZE];
     for (i = 1; i < sizeof(size_t) << 3; i <<= 1) {
       cnt |= cnt >> i;
     }
     cnt &= ~(cnt >> 1);
-    ints = alloca(cnt * HASH_SIZE);
-    memcpy(ints, hashes, (2 * cnt - count) * HASH_SIZE);
-    for (i = 2 * cnt - count, j = 2 * cnt - count; j < cnt; i += 2, ++j) {
-      cn_fast_hash(hashes[i], 2 * HASH_SIZE, ints[j]);
-    }
-    assert(i == count);
-    while (cnt > 2) {
-      cnt >>= 1;
-      for (i = 0, j = 0; j < cnt; i += 2, ++j) {
-        cn_fast_hash(ints[i], 64, ints[j]);
-      }
-    }
-    cn_fast_hash(ints[0], 2 * HASH_SIZE, root_hash);
+    subtree_hash(hashes, count, cnt, 0, cnt, root_hash);
   }
 }
 
@@ -55,40 +94,17 @@ size_t tree_depth(size_t count)
   return depth;
 }
 
+/* The sibling of the first leaf at height h over the level of cnt nodes is the subtree over the nodes
+ * 2^h to 2^(h+1) - 1, branch holds them from the top down. The first leaf is never read. */
 void tree_branch(const char (*hashes)[HASH_SIZE], size_t count, char (*branch)[HASH_SIZE])
 {
-  size_t i, j;
-  size_t cnt = 1;
-  size_t depth = 0;
-  char (*ints)[HASH_SIZE];
+  size_t height;
+  size_t depth = tree_depth(count);
+  size_t cnt = (size_t) 1 << depth;
   assert(count > 0);
-  for (i = sizeof(size_t) << 2; i > 0; i >>= 1)
-  {
-    if (cnt << i <= count)
-    {
-      cnt <<= i;
-      depth += i;
-    }
-  }
-  assert(cnt == 1ULL << depth);
-  assert(depth == tree_depth(count));
-  ints = alloca((cnt - 1) * HASH_SIZE);
-  memcpy(ints, hashes + 1, (2 * cnt - count - 1) * HASH_SIZE);
-  for (i = 2 * cnt - count, j = 2 * cnt - count - 1; j < cnt - 1; i += 2, ++j)
+  for (height = 0; height < depth; ++height)
   {
-    cn_fast_hash(hashes[i], 2 * HASH_SIZE, ints[j]);
-  }
-  assert(i == count);
-  while (depth > 0)
-  {
-    assert(cnt == 1ULL << depth);
-    cnt >>= 1;
-    --depth;
-    memcpy(branch[depth], ints[0], HASH_SIZE);
-    for (i = 1, j = 0; j < cnt - 1; i += 2, ++j)
-    {
-      cn_fast_hash(ints[i], 2 * HASH_SIZE, ints[j]);
-    }
+    subtree_hash(hashes, count, cnt, (size_t) 1 << height, (size_t) 1 << height, branch[depth - 1 - height]);
   }
 }
 
@@ -11,6 +11,7 @@ using namespace epee;
 #include "miner.h"
 #include "crypto/crypto.h"
 #include "crypto/hash.h"
+#include "crypto/scratchpad.h"
 #include "serialization/binary_utils.h"
 
 namespace cryptonote
@@ -18,10 +19,10 @@ namespace cryptonote
   //---------------------------------------------------------------
   void get_transaction_prefix_hash(const transaction_prefix& tx, crypto::hash& h)
   {
-    std::ostringstream s;
-    binary_archive<true> a(s);
+    blobdata blob;
+    binary_archive<true> a(blob);
     ::serialization::serialize(a, const_cast<transaction_prefix&>(tx));
-    crypto::cn_fast_hash(s.str().data(), s.str().size(), h);
+    crypto::cn_fast_hash(blob.data(), blob.size(), h);
   }
   //---------------------------------------------------------------
   crypto::hash get_transaction_prefix_hash(const transaction_prefix& tx)
@@ -33,20 +34,14 @@ namespace cryptonote
   //---------------------------------------------------------------
   bool parse_and_validate_tx_from_blob(const blobdata& tx_blob, transaction& tx)
   {
-    std::stringstream ss;
-    ss << tx_blob;
-    binary_archive<false> ba(ss);
-    bool r = ::serialization::serialize(ba, tx);
+    bool r = ::serialization::parse_binary(tx_blob, tx);
     CHECK_AND_ASSERT_MES(r, false, "Failed to parse transaction from blob");
     return true;
   }
   //---------------------------------------------------------------
   bool parse_and_validate_tx_from_blob(const blobdata& tx_blob, transaction& tx, crypto::hash& tx_hash, crypto::hash& tx_prefix_hash)
   {
-    std::stringstream ss;
-    ss << tx_blob;
-    binary_archive<false> ba(ss);
-    bool r = ::serialization::serialize(ba, tx);
+    bool r = ::serialization::parse_binary(tx_blob, tx);
     CHECK_AND_ASSERT_MES(r, false, "Failed to parse transaction from blob");
     //TODO: validate tx
 
@@ -757,18 +752,14 @@ namespace cryptonote
     if(!get_bytecoin_block_hashing_blob(b, bd))
       return false;
 
-    uint8_t* long_state = new uint8_t[1 << 21];
-    crypto::cn_slow_hash(bd.data(), bd.size(), res, long_state);
-    delete[] long_state;
+    crypto::scratchpad scratchpad;
+    crypto::cn_slow_hash(bd.data(), bd.size(), res, scratchpad.data());
     return true;
   }
   //---------------------------------------------------------------
   bool parse_and_validate_block_from_blob(const blobdata& b_blob, block& b)
   {
-    std::stringstream ss;
-    ss << b_blob;
-    binary_archive<false> ba(ss);
-    bool r = ::serialization::serialize(ba, b);
+    bool r = ::serialization::parse_binary(b_blob, b);
     CHECK_AND_ASSERT_MES(r, false, "Failed to parse block from blob");
     return true;
   }
@@ -822,9 +813,8 @@ namespace cryptonote
     if (BLOCK_MAJOR_VERSION_1 != bl.major_version)
       return false;
 
-    uint8_t* long_state = new uint8_t[1 << 21];
-    proof_of_work = get_block_longhash(bl, 0, long_state);
-    delete[] long_state;
+    crypto::scratchpad scratchpad;
+    proof_of_work = get_block_longhash(bl, 0, scratchpad.data());
     return check_hash(proof_of_work, current_diffic);
   }
   //---------------------------------------------------------------
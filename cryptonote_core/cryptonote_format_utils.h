@@ -88,14 +88,13 @@ namespace cryptonote
   std::vector<uint64_t> absolute_output_offsets_to_relative(const std::vector<uint64_t>& off);
   std::string print_money(uint64_t amount);
   //---------------------------------------------------------------
+  // Serializes straight into b_blob, a blob passed again keeps its memory
   template<class t_object>
   bool t_serializable_object_to_blob(const t_object& to, blobdata& b_blob)
   {
-    std::stringstream ss;
-    binary_archive<true> ba(ss);
-    bool r = ::serialization::serialize(ba, const_cast<t_object&>(to));
-    b_blob = ss.str();
-    return r;
+    b_blob.clear();
+    binary_archive<true> ba(b_blob);
+    return ::serialization::serialize(ba, const_cast<t_object&>(to));
   }
   //---------------------------------------------------------------
   template<class t_object>
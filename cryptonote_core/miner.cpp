@@ -16,6 +16,7 @@
 #include "file_io_utils.h"
 #include "common/command_line.h"
 #include "string_coding.h"
+#include "crypto/scratchpad.h"
 #include "storages/portable_storage_template_helper.h"
 
 using namespace epee;
@@ -267,12 +268,11 @@ namespace cryptonote
   //-----------------------------------------------------------------------------------------------------
   bool miner::find_nonce_for_given_block(block& bl, const difficulty_type& diffic, uint64_t height)
   {
+    crypto::scratchpad scratchpad;
     for(; bl.nonce != std::numeric_limits<uint32_t>::max(); bl.nonce++)
     {
       crypto::hash h;
-      uint8_t* long_state = new uint8_t[1 << 21];
-      get_block_longhash(bl, h, height, long_state);
-      delete[] long_state;
+      get_block_longhash(bl, h, height, scratchpad.data());
 
       if(check_hash(h, diffic))
       {
@@ -324,6 +324,7 @@ namespace cryptonote
     difficulty_type local_diff = 0;
     uint32_t local_template_ver = 0;
     block b;
+    crypto::scratchpad scratchpad;
     while(!m_stop)
     {
       if(m_pausers_count)//anti split workaround
@@ -355,14 +356,11 @@ namespace cryptonote
       if(BLOCK_MAJOR_VERSION_1 == b.major_version)
       {
         b.nonce = nonce;
-        uint8_t* long_state = new uint8_t[1 << 21];
-        if(!get_block_longhash(b, h, height, long_state))
+        if(!get_block_longhash(b, h, height, scratchpad.data()))
         {
           LOG_ERROR("Failed to get block long hash");
           m_stop = true;
         }
-
-        delete[] long_state;
       }
       else if(BLOCK_MAJOR_VERSION_2 == b.major_version)
       {
@@ -1,6 +1,7 @@
 #include <future>
 #include <sstream>
 #include <thread>
+#include <vector>
 #include <wx/app.h>
 #include <wx/button.h>
 #include <wx/combobox.h>
@@ -22,7 +23,7 @@ public:
 
     wxSizer* sizer = new wxBoxSizer(wxVERTICAL);
 
-    wxString donorNetworks[] = { "Bytecoin (BCN)", "BitMonero (BMR)", "QuazarCoin (QCN)" };
+    wxString donorNetworks[] = { "Bytecoin (BCN)", "BitMonero (BMR)", "QuazarCoin (QCN)", "Aeon (AEON)" };
     d_donorNetworkRadioBox = new wxRadioBox(panel, wxID_ANY, "Donor network", wxDefaultPosition, wxDefaultSize, sizeof donorNetworks / sizeof donorNetworks[0], donorNetworks, 0, wxRA_SPECIFY_COLS);
     d_donorNetworkRadioBox->Bind(wxEVT_RADIOBOX, &SoloMinerFrame::onDonorNetworkChanged, this);
     sizer->Add(d_donorNetworkRadioBox, 0, wxALL, 5);
@@ -74,6 +75,20 @@ public:
     threadCountSizer->Add(d_threadCountChoice, 1, wxALIGN_CENTRE_VERTICAL | wxLEFT, 5);
     sizer->Add(threadCountSizer, 0, wxALL | wxGROW, 5);
 
+    wxSizer* waysSizer = new wxBoxSizer(wxHORIZONTAL);
+    waysSizer->Add(new wxStaticText(panel, wxID_ANY, "Hashes per thread:"), 0, wxALIGN_CENTRE_VERTICAL | wxRIGHT, 5);
+    d_waysChoice = new wxChoice(panel, wxID_ANY);
+    d_waysChoice->Append("Auto");
+    for (unsigned int i = 0; i < 4; ++i) {
+      std::ostringstream stream;
+      stream << i + 1;
+      d_waysChoice->Append(stream.str());
+    }
+
+    d_waysChoice->SetSelection(0);
+    waysSizer->Add(d_waysChoice, 1, wxALIGN_CENTRE_VERTICAL | wxLEFT, 5);
+    sizer->Add(waysSizer, 0, wxALL | wxGROW, 5);
+
     d_mineButton = new wxButton(panel, 100, "Start mining");
     d_mineButton->Bind(wxEVT_BUTTON, &SoloMinerFrame::onMineButton, this);
     sizer->Add(d_mineButton, 0, wxALL, 5);
@@ -85,7 +100,6 @@ public:
 
     wxCommandEvent commandEvent;
     onDonorNetworkChanged(commandEvent);
-    onAcceptorNetworkChanged(commandEvent);
 
     d_timer.Bind(wxEVT_TIMER, &SoloMinerFrame::onTimer, this);
     d_timer.Start(100);
@@ -100,6 +114,7 @@ private:
   wxTextCtrl *d_acceptorWalletTextCtrl;
   wxChoice* d_acceptorHostChoice;
   wxChoice* d_threadCountChoice;
+  wxChoice* d_waysChoice;
   wxButton* d_mineButton;
   wxTextCtrl* d_messagesTextCtrl;
   wxTimer d_timer;
@@ -120,12 +135,31 @@ private:
       d_donorHostChoice->Append("127.0.0.1:18081");
       d_donorHostChoice->SetSelection(0);
       d_donorHostChoice->Disable();
-    } else {
+    } else if (d_donorNetworkRadioBox->GetSelection() == 2) {
       d_donorHostChoice->Clear();
       d_donorHostChoice->Append("127.0.0.1:23081");
       d_donorHostChoice->SetSelection(0);
       d_donorHostChoice->Disable();
+    } else {
+      d_donorHostChoice->Clear();
+      d_donorHostChoice->Append("127.0.0.1:11181");
+      d_donorHostChoice->SetSelection(0);
+      d_donorHostChoice->Disable();
+    }
+
+    // Aeon hashes with CryptoNight-Lite, which no acceptor network can be merged into
+    if (isLiteDonorNetwork()) {
+      d_acceptorNetworkRadioBox->SetSelection(0);
+      d_acceptorNetworkRadioBox->Disable();
+    } else {
+      d_acceptorNetworkRadioBox->Enable();
     }
+
+    onAcceptorNetworkChanged(event);
+  }
+
+  bool isLiteDonorNetwork() const {
+    return d_donorNetworkRadioBox->GetSelection() == 3;
   }
 
   void onAcceptorNetworkChanged(wxCommandEvent& event) {
@@ -155,13 +189,18 @@ private:
       d_messagesTextCtrl->AppendText("Mining stopped\n");
       d_mineButton->SetLabel("Start mining");
     } else {
-      std::string address1(d_donorHostChoice->GetString(d_donorHostChoice->GetSelection()));
+      std::vector<std::string> addresses1(getHostAddresses(d_donorHostChoice));
       std::string wallet1(d_donorWalletTextCtrl->GetLineText(0));
-      std::string address2(d_acceptorHostChoice->GetString(d_acceptorHostChoice->GetSelection()));
+      std::vector<std::string> addresses2(getHostAddresses(d_acceptorHostChoice));
       std::string wallet2(d_acceptorWalletTextCtrl->GetLineText(0));
       size_t threads;
       std::istringstream(std::string(d_threadCountChoice->GetString(d_threadCountChoice->GetSelection()))) >> threads;
-      d_mining = std::async(std::launch::async, &MergedMiner::mine, &d_mergedMiner, address1, wallet1, address2, wallet2, threads);
+      size_t ways = 0;
+      if (d_waysChoice->GetSelection() != 0) {
+        std::istringstream(std::string(d_waysChoice->GetString(d_waysChoice->GetSelection()))) >> ways;
+      }
+      d_mergedMiner.setAlgorithm(isLiteDonorNetwork() ? crypto::CN_ALGORITHM_CRYPTONIGHT_LITE : crypto::CN_ALGORITHM_CRYPTONIGHT);
+      d_mining = std::async(std::launch::async, &MergedMiner::mine, &d_mergedMiner, addresses1, wallet1, addresses2, wallet2, threads, ways);
       d_isMining = true;
       d_messagesTextCtrl->AppendText("Mining started\n");
       d_mineButton->SetLabel("Stop mining");
@@ -179,6 +218,24 @@ private:
     }
   }
 
+  // The selected host comes first, the others of the network back it up
+  static std::vector<std::string> getHostAddresses(wxChoice* hostChoice) {
+    std::vector<std::string> addresses;
+    int selection = hostChoice->GetSelection();
+    if (selection == wxNOT_FOUND) {
+      return addresses;
+    }
+
+    addresses.push_back(std::string(hostChoice->GetString(selection)));
+    for (unsigned int i = 0; i < hostChoice->GetCount(); ++i) {
+      if (static_cast<int>(i) != selection) {
+        addresses.push_back(std::string(hostChoice->GetString(i)));
+      }
+    }
+
+    return addresses;
+  }
+
   void processMessages() {
     std::string message;
     for (;;) {
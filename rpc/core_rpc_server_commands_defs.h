@@ -349,6 +349,31 @@ namespace cryptonote
       END_KV_SERIALIZE_MAP()
     };
   };
+  //-----------------------------------------------
+  // Binary counterparts of getblocktemplate and submitblock, posted as portable storage to their own
+  // URIs. The blobs go as they are rather than as hex.
+#define CORE_RPC_GETBLOCKTEMPLATE_BIN_URI "/getblocktemplate.bin"
+#define CORE_RPC_SUBMITBLOCK_BIN_URI "/submitblock.bin"
+
+  struct COMMAND_RPC_GETBLOCKTEMPLATE_BIN
+  {
+    typedef COMMAND_RPC_GETBLOCKTEMPLATE::request request;
+    typedef COMMAND_RPC_GETBLOCKTEMPLATE::response response;
+  };
+
+  struct COMMAND_RPC_SUBMITBLOCK_BIN
+  {
+    struct request
+    {
+      blobdata block_blob;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(block_blob)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    typedef COMMAND_RPC_SUBMITBLOCK::response response;
+  };
   
   struct block_header_responce
   {
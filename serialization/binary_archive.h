@@ -8,8 +8,11 @@
 #pragma once
 
 #include <cassert>
-#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <ios>
 #include <iterator>
+#include <string>
 #include <boost/type_traits/make_unsigned.hpp>
 
 #include "common/varint.h"
@@ -20,6 +23,65 @@ DISABLE_VS_WARNINGS(4244)
 
 //TODO: fix size_t warning in x32 platform
 
+/* The archives read from a span of bytes and append to a string instead of
+ * going through iostreams. Their streams keep the state bits the serializers
+ * check and set through ar.stream(), the way an iostream would. */
+class binary_stream_state
+{
+public:
+  binary_stream_state() : state_(std::ios_base::goodbit) { }
+
+  bool good() const { return state_ == std::ios_base::goodbit; }
+  std::ios_base::iostate rdstate() const { return state_; }
+  void setstate(std::ios_base::iostate state) { state_ |= state; }
+protected:
+  std::ios_base::iostate state_;
+};
+
+class binary_span_stream : public binary_stream_state
+{
+public:
+  binary_span_stream(const uint8_t *data, size_t size) : pos_(data), end_(data + size) { }
+
+  int peek()
+  {
+    if (pos_ == end_) {
+      setstate(std::ios_base::eofbit);
+      return EOF;
+    }
+    return *pos_;
+  }
+  // Fails without reading anything when fewer than len bytes are left
+  bool read(void *buf, size_t len)
+  {
+    if (remaining() < len) {
+      setstate(std::ios_base::eofbit | std::ios_base::failbit);
+      return false;
+    }
+    memcpy(buf, pos_, len);
+    pos_ += len;
+    return true;
+  }
+  const uint8_t *&position() { return pos_; }
+  const uint8_t *end() const { return end_; }
+  size_t remaining() const { return end_ - pos_; }
+private:
+  const uint8_t *pos_;
+  const uint8_t *end_;
+};
+
+class binary_buffer_stream : public binary_stream_state
+{
+public:
+  explicit binary_buffer_stream(std::string &buffer) : buffer_(&buffer) { }
+
+  void put(char c) { buffer_->push_back(c); }
+  void write(const char *buf, size_t len) { buffer_->append(buf, len); }
+  std::string &buffer() { return *buffer_; }
+private:
+  std::string *buffer_;
+};
+
 template <class Stream, bool IsSaving>
 struct binary_archive_base
 {
@@ -29,7 +91,7 @@ struct binary_archive_base
 
   typedef uint8_t variant_tag_type;
 
-  explicit binary_archive_base(stream_type &s) : stream_(s) { }
+  explicit binary_archive_base(const stream_type &s) : stream_(s) { }
 
   void tag(const char *) { }
   void begin_object() { }
@@ -38,21 +100,17 @@ struct binary_archive_base
   void end_variant() { }
   stream_type &stream() { return stream_; }
 protected:
-  stream_type &stream_;
+  stream_type stream_;
 };
 
 template <bool W>
 struct binary_archive;
 
+// Reads from the span it is given, which has to outlive it
 template <>
-struct binary_archive<false> : public binary_archive_base<std::istream, false>
+struct binary_archive<false> : public binary_archive_base<binary_span_stream, false>
 {
-  explicit binary_archive(stream_type &s) : base_type(s) {
-    stream_type::streampos pos = stream_.tellg();
-    stream_.seekg(0, std::ios_base::end);
-    eof_pos_ = stream_.tellg();
-    stream_.seekg(pos);
-  }
+  binary_archive(const uint8_t *data, size_t size) : base_type(binary_span_stream(data, size)) { }
 
   template <class T>
   void serialize_int(T &v)
@@ -63,19 +121,16 @@ struct binary_archive<false> : public binary_archive_base<std::istream, false>
   template <class T>
   void serialize_uint(T &v, size_t width = sizeof(T))
   {
+    unsigned char bytes[sizeof(T)];
+    if (!stream_.read(bytes, width))
+      return;
     T ret = 0;
-    unsigned shift = 0;
     for (size_t i = 0; i < width; i++) {
-      //std::cerr << "tell: " << stream_.tellg() << " value: " << ret << std::endl;
-      char c;
-      stream_.get(c);
-      T b = (unsigned char)c;
-      ret += (b << shift);
-      shift += 8;
+      ret |= (T)bytes[i] << (8 * i);
     }
     v = ret;
   }
-  void serialize_blob(void *buf, size_t len, const char *delimiter="") { stream_.read((char *)buf, len); }
+  void serialize_blob(void *buf, size_t len, const char *delimiter="") { stream_.read(buf, len); }
 
   template <class T>
   void serialize_varint(T &v)
@@ -86,8 +141,7 @@ struct binary_archive<false> : public binary_archive_base<std::istream, false>
   template <class T>
   void serialize_uvarint(T &v)
   {
-    typedef std::istreambuf_iterator<char> it;
-    tools::read_varint(it(stream_), it(), v); // XXX handle failure
+    tools::read_varint_span(stream_.position(), stream_.end(), v); // XXX handle failure
   }
   void begin_array(size_t &s)
   {
@@ -108,18 +162,15 @@ struct binary_archive<false> : public binary_archive_base<std::istream, false>
   size_t remaining_bytes() {
     if (!stream_.good())
       return 0;
-    //std::cerr << "tell: " << stream_.tellg() << std::endl;
-    assert(stream_.tellg() <= eof_pos_);
-    return eof_pos_ - stream_.tellg();
+    return stream_.remaining();
   }
-protected:
-  std::streamoff eof_pos_;
 };
 
+// Appends to the buffer it is given, which can be cleared and handed to the next archive to reuse its memory
 template <>
-struct binary_archive<true> : public binary_archive_base<std::ostream, true>
+struct binary_archive<true> : public binary_archive_base<binary_buffer_stream, true>
 {
-  explicit binary_archive(stream_type &s) : base_type(s) { }
+  explicit binary_archive(std::string &buffer) : base_type(binary_buffer_stream(buffer)) { }
 
   template <class T>
   void serialize_int(T v)
@@ -129,12 +180,14 @@ struct binary_archive<true> : public binary_archive_base<std::ostream, true>
   template <class T>
   void serialize_uint(T v)
   {
+    char bytes[sizeof(T)];
     for (size_t i = 0; i < sizeof(T); i++) {
-      stream_.put((char)(v & 0xff));
+      bytes[i] = (char)(v & 0xff);
       if (1 < sizeof(T)) {
         v >>= 8;
       }
     }
+    stream_.write(bytes, sizeof(T));
   }
   void serialize_blob(void *buf, size_t len, const char *delimiter="") { stream_.write((char *)buf, len); }
 
@@ -147,8 +200,8 @@ struct binary_archive<true> : public binary_archive_base<std::ostream, true>
   template <class T>
   void serialize_uvarint(T &v)
   {
-    typedef std::ostreambuf_iterator<char> it;
-    tools::write_varint(it(stream_), v);
+    uint8_t buf[tools::VARINT_MAX_SIZE];
+    stream_.write((char *)buf, tools::write_varint_span(buf, v));
   }
   void begin_array(size_t s)
   {
@@ -4,27 +4,31 @@
 
 #pragma once
 
-#include <sstream>
+#include <string>
 #include "binary_archive.h"
 
 namespace serialization {
 
 template <class T>
-bool parse_binary(const std::string &blob, T &v)
+bool parse_binary(const uint8_t *data, size_t size, T &v)
 {
-  std::istringstream istr(blob);
-  binary_archive<false> iar(istr);
+  binary_archive<false> iar(data, size);
   return ::serialization::serialize(iar, v);
 }
 
+template <class T>
+bool parse_binary(const std::string &blob, T &v)
+{
+  return parse_binary(reinterpret_cast<const uint8_t *>(blob.data()), blob.size(), v);
+}
+
 template<class T>
 bool dump_binary(T& v, std::string& blob)
 {
-  std::stringstream ostr;
-  binary_archive<true> oar(ostr);
+  blob.clear();
+  binary_archive<true> oar(blob);
   bool success = ::serialization::serialize(oar, v);
-  blob = ostr.str();
-  return success && ostr.good();
+  return success && oar.stream().good();
 };
 
 } // namespace serialization
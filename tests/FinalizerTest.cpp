@@ -0,0 +1,174 @@
+// Checks the CryptoNight finalizers against known answers of the baseline implementations, and groestl_aesni
+// against the table groestl. Each known answer is for the empty message, a 200-byte message and cn_fast_hash of
+// the digests of every message length from 0 to MAX_SIZE.
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+extern "C" {
+#include "crypto/blake256.h"
+#include "crypto/cpu-features.h"
+#include "crypto/groestl.h"
+#include "crypto/hash-ops.h"
+#include "crypto/jh.h"
+}
+
+// Every length up to here, so that each finalizer pads into one and into a new block many times
+static const size_t MAX_SIZE = 1024;
+
+typedef void (*Digest)(const uint8_t* data, size_t size, uint8_t* hash);
+
+struct KnownAnswers {
+  const char* name;
+  Digest digest;
+  size_t digestSize;
+  const char* empty;
+  const char* bytes200;
+  const char* all;
+};
+
+static size_t failures = 0;
+
+static std::string toHex(const void* data, size_t size) {
+  static const char digits[] = "0123456789abcdef";
+  std::string hex;
+  for (size_t i = 0; i < size; ++i) {
+    unsigned char byte = static_cast<const unsigned char*>(data)[i];
+    hex.push_back(digits[byte >> 4]);
+    hex.push_back(digits[byte & 0x0F]);
+  }
+
+  return hex;
+}
+
+static void groestlTables(const uint8_t* data, size_t size, uint8_t* hash) {
+  groestl(data, size * 8, hash);
+}
+
+static void groestlAesni(const uint8_t* data, size_t size, uint8_t* hash) {
+  groestl_aesni(data, size, hash);
+}
+
+static void blake256(const uint8_t* data, size_t size, uint8_t* hash) {
+  blake256_hash(hash, data, size);
+}
+
+template<int bits>
+static void jh(const uint8_t* data, size_t size, uint8_t* hash) {
+  jh_hash(bits, data, size * 8, hash);
+}
+
+// What hash_extra_groestl checks before it takes groestl_aesni
+static bool groestlAesniSupported() {
+  return (cpu_features() & (CPU_AES | CPU_SSSE3)) == (CPU_AES | CPU_SSSE3);
+}
+
+static void checkDigest(const char* name, const char* what, const std::string& actual, const char* expected) {
+  if (actual != expected) {
+    ++failures;
+    std::printf("FAIL %s %s: %s\n", name, what, actual.c_str());
+  }
+}
+
+static void checkKnownAnswers(const KnownAnswers& answers, const uint8_t* message) {
+  size_t before = failures;
+  std::string digests;
+  for (size_t size = 0; size <= MAX_SIZE; ++size) {
+    uint8_t hash[64];
+    answers.digest(message, size, hash);
+    if (size == 0) {
+      checkDigest(answers.name, "empty", toHex(hash, answers.digestSize), answers.empty);
+    } else if (size == 200) {
+      checkDigest(answers.name, "200 bytes", toHex(hash, answers.digestSize), answers.bytes200);
+    }
+
+    digests.append(reinterpret_cast<const char*>(hash), answers.digestSize);
+  }
+
+  char all[HASH_SIZE];
+  cn_fast_hash(digests.data(), digests.size(), all);
+  checkDigest(answers.name, "all lengths", toHex(all, HASH_SIZE), answers.all);
+  std::printf("%s: %s\n", answers.name, failures == before ? "ok" : "failed");
+}
+
+// Random messages of every length, placed at every offset into a word so that unaligned loads come up
+static void checkGroestlAesni() {
+  if (!groestlAesniSupported()) {
+    std::printf("groestl_aesni against groestl: not supported by this CPU\n");
+    return;
+  }
+
+  std::mt19937 random(0x5eed);
+  size_t before = failures;
+  uint8_t buffer[MAX_SIZE + 8];
+  for (size_t size = 0; size <= MAX_SIZE; ++size) {
+    for (uint8_t& byte : buffer) {
+      byte = static_cast<uint8_t>(random());
+    }
+
+    const uint8_t* data = buffer + size % 8;
+    uint8_t expected[32];
+    uint8_t actual[32];
+    groestlTables(data, size, expected);
+    groestlAesni(data, size, actual);
+    if (std::memcmp(actual, expected, sizeof(actual)) != 0) {
+      ++failures;
+      std::printf("FAIL groestl_aesni of %u bytes\n", static_cast<unsigned>(size));
+    }
+  }
+
+  std::printf("groestl_aesni against groestl: %s\n", failures == before ? "ok" : "failed");
+}
+
+int main() {
+  // Digests of the baseline code, those of the empty message are the published ones
+  static const KnownAnswers KNOWN_ANSWERS[] = {
+    { "groestl", groestlTables, 32,
+      "1a52d11d550039be16107f9c58db9ebcc417f16f736adb2502567119f0083467",
+      "5e4874941276bacd43cf9f5078a5d620143b0b105f633f44d65ed13d27f6a849",
+      "7037f16d4678db7d40c1dc58b7d1b6a023bef2c3cdc6ca1a028955c84db8ef3d" },
+    { "groestl_aesni", groestlAesni, 32,
+      "1a52d11d550039be16107f9c58db9ebcc417f16f736adb2502567119f0083467",
+      "5e4874941276bacd43cf9f5078a5d620143b0b105f633f44d65ed13d27f6a849",
+      "7037f16d4678db7d40c1dc58b7d1b6a023bef2c3cdc6ca1a028955c84db8ef3d" },
+    { "blake256", blake256, 32,
+      "716f6e863f744b9ac22c97ec7b76ea5f5908bc5b2f67c61510bfc4751384ea7a",
+      "c4d944c2b1c00a8ee627726b35d4cd7fe018de090bc637553cc782e25f974cba",
+      "53e2dda74e392f317c0e1245bef6ad2c4d9a8bb2376c407ce1ffcca0b4dda426" },
+    { "jh224", jh<224>, 28,
+      "2c99df889b019309051c60fecc2bd285a774940e43175b76b2626630",
+      "6fe905e84fdaed0c15310477c13dfc4cdb598df18916ab9b488faee1",
+      "f4ab6c96b8d77de78e8f3571aa8f844bec7597a80c15e6c63cc6ee906d8f3a50" },
+    { "jh256", jh<256>, 32,
+      "46e64619c18bb0a92a5e87185a47eef83ca747b8fcc8e1412921357e326df434",
+      "4ae8dbb5ad87640ff66f125380d25d3c691464d9690eaa2df577e5fe11c7b76b",
+      "319519f0409507c7b5dddce2dcb8c907ac8d32c886d6c179221902153ed37f4d" },
+    { "jh384", jh<384>, 48,
+      "2fe5f71b1b3290d3c017fb3c1a4d02a5cbeb03a0476481e25082434a881994b0ff99e078d2c16b105ad069b569315328",
+      "f31d64aa6fb889c395624c23e37c306220a380b08c6fcfc30ce51749f65c6d37c61d4a73e691284e2ef83daa1170dca3",
+      "c8bb23277da85756b9564bceae000e11ae529f73cd552b8d6c30d2571bf55628" },
+    { "jh512", jh<512>, 64,
+      "90ecf2f76f9d2c8017d979ad5ab96b87d58fc8fc4b83060f3f900774faa2c8fabe69c5f4ff1ec2b61d6b316941cedee117fb04b1f4c5bc1b919ae841c50eec4f",
+      "f887f615cf46099a0582a23e7dd8cb5110de8d0056840d20bf38bde116defd27faba3bf6d4df1cf34acef5df1b660a393e836f960e8dc88c604704b031428465",
+      "c90accf1de4c094c8862ce196885c5cd30ea48329f111b87ee122c58c6039cec" }
+  };
+
+  uint8_t message[MAX_SIZE];
+  for (size_t i = 0; i < MAX_SIZE; ++i) {
+    message[i] = static_cast<uint8_t>(i % 251);
+  }
+
+  for (const KnownAnswers& answers : KNOWN_ANSWERS) {
+    if (answers.digest == groestlAesni && !groestlAesniSupported()) {
+      std::printf("%s: not supported by this CPU\n", answers.name);
+      continue;
+    }
+
+    checkKnownAnswers(answers, message);
+  }
+
+  checkGroestlAesni();
+  std::printf("%u failures\n", static_cast<unsigned>(failures));
+  return failures == 0 ? 0 : 1;
+}
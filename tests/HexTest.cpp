@@ -0,0 +1,92 @@
+// Checks the hex conversions of string_tools against the stringstream and strtoul based templates they replaced.
+// Built once per path: with EPEE_HEX_SCALAR and with the default SSE2 baseline.
+#include <cctype>
+#include <cstdio>
+#include <iomanip>
+#include <random>
+#include <string>
+#include "string_tools.h"
+
+using namespace epee::string_tools;
+
+#if defined(EPEE_HEX_SSE2)
+static const char* const PATH = "sse2";
+#else
+static const char* const PATH = "scalar";
+#endif
+
+// Not accepted by strtoul anywhere in a digit pair, unlike white space, '+' and '-'
+static const char INVALID_CHARS[] = { 'g', 'G', 'x', 'X', '/', ':', '@', '`', '\0', '\x7f', '\x80', '\xb0', '\xe6', '\xff' };
+
+// Several SSE2 blocks, so that every length mixes vector blocks and a scalar tail
+static const size_t MAX_SIZE = 160;
+
+static size_t failures = 0;
+
+static void fail(const std::string& what, const std::string& input) {
+  ++failures;
+  std::printf("FAIL %s: %s\n", what.c_str(), buff_to_hex_nodelimer<char>(input).c_str());
+}
+
+static void checkEncoding(const std::string& blob) {
+  if (buff_to_hex_nodelimer(blob) != buff_to_hex_nodelimer<char>(blob)) {
+    fail("encoding", blob);
+  }
+}
+
+static void checkDecoding(const std::string& hex) {
+  std::string expected;
+  std::string actual;
+  bool expectedValid = parse_hexstr_to_binbuff<char>(hex, expected);
+  bool actualValid = parse_hexstr_to_binbuff(hex, actual);
+  if (actualValid != expectedValid || (actualValid && actual != expected) || (!actualValid && !actual.empty())) {
+    fail("decoding", hex);
+  }
+}
+
+static void checkRejected(const std::string& hex) {
+  std::string blob;
+  if (parse_hexstr_to_binbuff(hex, blob)) {
+    fail("not rejected", hex);
+  }
+}
+
+int main() {
+  std::mt19937 random(0x5eed);
+  for (size_t size = 0; size <= MAX_SIZE; ++size) {
+    for (size_t round = 0; round < 8; ++round) {
+      std::string blob(size, '\0');
+      for (char& byte : blob) {
+        byte = static_cast<char>(random());
+      }
+
+      checkEncoding(blob);
+      std::string hex = buff_to_hex_nodelimer(blob);
+      for (char& digit : hex) {
+        if (random() & 1) {
+          digit = static_cast<char>(std::toupper(static_cast<unsigned char>(digit)));
+        }
+      }
+
+      checkDecoding(hex);
+      if (!hex.empty()) {
+        // An odd trailing digit makes a byte of its own
+        checkDecoding(hex.substr(0, hex.size() - 1));
+        std::string corrupted = hex;
+        corrupted[random() % hex.size()] = INVALID_CHARS[random() % sizeof(INVALID_CHARS)];
+        checkDecoding(corrupted);
+      }
+    }
+  }
+
+  // The strtoul parser took a sign or white space in front of a digit, these are malformed hex now
+  checkRejected("+f");
+  checkRejected(" a");
+  checkRejected(std::string(64, '0') + "+f");
+  checkRejected(std::string(64, '0') + " a");
+  checkRejected(std::string(30, '0') + "+f" + std::string(32, '0'));
+  checkRejected(std::string(62, '0') + " a" + std::string(64, '0'));
+
+  std::printf("%s: %u failures\n", PATH, static_cast<unsigned>(failures));
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+// Checks the unrolled keccakf variants against the baseline keccakf_reference, and cn_fast_hash against
+// Keccak-256 digests.
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+extern "C" {
+#include "crypto/hash-ops.h"
+#include "crypto/keccak.h"
+}
+
+typedef void (*Permutation)(uint64_t st[25], int rounds);
+
+// First lane of the zero state after Keccak-f[1600]
+static const uint64_t ZERO_STATE_LANE = 0xf1258f7940e1dde7;
+
+static size_t failures = 0;
+
+static std::string toHex(const void* data, size_t size) {
+  static const char digits[] = "0123456789abcdef";
+  std::string hex;
+  for (size_t i = 0; i < size; ++i) {
+    unsigned char byte = static_cast<const unsigned char*>(data)[i];
+    hex.push_back(digits[byte >> 4]);
+    hex.push_back(digits[byte & 0x0F]);
+  }
+
+  return hex;
+}
+
+static void checkPermutation(const char* name, Permutation permutation) {
+  std::mt19937_64 random(0x5eed);
+  size_t before = failures;
+  uint64_t state[25] = {};
+  permutation(state, KECCAK_ROUNDS);
+  if (state[0] != ZERO_STATE_LANE) {
+    ++failures;
+    std::printf("FAIL %s: zero state\n", name);
+  }
+
+  // Every round count, so that an odd last round is covered too
+  for (int rounds = 0; rounds <= KECCAK_ROUNDS; ++rounds) {
+    for (size_t i = 0; i < 100; ++i) {
+      uint64_t expected[25];
+      uint64_t actual[25];
+      for (uint64_t& lane : expected) {
+        lane = random();
+      }
+
+      std::memcpy(actual, expected, sizeof(actual));
+      keccakf_reference(expected, rounds);
+      permutation(actual, rounds);
+      if (std::memcmp(actual, expected, sizeof(actual)) != 0) {
+        ++failures;
+        std::printf("FAIL %s: %d rounds\n", name, rounds);
+        break;
+      }
+    }
+  }
+
+  std::printf("%s: %s\n", name, failures == before ? "ok" : "failed");
+}
+
+static void checkFastHash(const std::string& data, const char* digest) {
+  char hash[HASH_SIZE];
+  cn_fast_hash(data.data(), data.size(), hash);
+  if (toHex(hash, HASH_SIZE) != digest) {
+    ++failures;
+    std::printf("FAIL cn_fast_hash of %u bytes\n", static_cast<unsigned>(data.size()));
+  }
+}
+
+int main() {
+  checkPermutation("keccakf_portable", keccakf_portable);
+  if (keccakf_bmi2_supported()) {
+    checkPermutation("keccakf_bmi2", keccakf_bmi2);
+  } else {
+    std::printf("keccakf_bmi2: not supported by this CPU\n");
+  }
+
+  checkPermutation("keccakf", keccakf);
+  checkFastHash("", "c5d2460186f7233c927e7db2dcc703c0e500b653ca82273b7bfad8045d85a470");
+  checkFastHash("abc", "4e03657aea45a94fc7d47ba826c8d667c0d1e6e33a64a036ec44f58fa12d6c45");
+  // Two blocks, digest of the baseline implementation
+  checkFastHash(std::string(200, 'a'), "96ea54061def936c4be90b518992fdc6f12f535068a256229aca54267b4d084d");
+  std::printf("%u failures\n", static_cast<unsigned>(failures));
+  return failures == 0 ? 0 : 1;
+}
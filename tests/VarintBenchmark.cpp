@@ -0,0 +1,210 @@
+// Times parse_binary, which reads varints with read_varint_span, against an archive reading them with the
+// iterator based read_varint, on blocks and transactions shaped like those of a CryptoNote chain.
+//
+//   VarintBenchmark [<rounds>]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#include "cryptonote_core/cryptonote_basic.h"
+#include "serialization/binary_utils.h"
+
+static const size_t BLOCKS = 200;
+static const size_t TRANSACTIONS = 2000;
+static const size_t DEFAULT_ROUNDS = 50;
+
+// binary_archive<false> as it was before read_varint_span, everything but the varints is shared
+template <bool W>
+struct iterator_archive;
+
+template <>
+struct iterator_archive<false> : public binary_archive<false>
+{
+  iterator_archive(const uint8_t *data, size_t size) : binary_archive<false>(data, size) { }
+
+  template <class T>
+  void serialize_varint(T &v)
+  {
+    serialize_uvarint(*(typename boost::make_unsigned<T>::type *)(&v));
+  }
+
+  template <class T>
+  void serialize_uvarint(T &v)
+  {
+    const uint8_t *last = stream_.end();
+    tools::read_varint<std::numeric_limits<T>::digits>(stream_.position(), last, v);
+  }
+  void begin_array(size_t &s)
+  {
+    serialize_varint(s);
+  }
+  void begin_array() { }
+};
+
+template <bool W, class T>
+struct variant_serialization_traits<iterator_archive<W>, T> : public variant_serialization_traits<binary_archive<W>, T> { };
+
+template<class T>
+static bool parseIterator(const std::string& blob, T& v) {
+  iterator_archive<false> ar(reinterpret_cast<const uint8_t*>(blob.data()), blob.size());
+  return ::serialization::serialize(ar, v);
+}
+
+template<class T>
+static void randomPod(std::mt19937_64& random, T& pod) {
+  uint8_t* bytes = reinterpret_cast<uint8_t*>(&pod);
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    bytes[i] = static_cast<uint8_t>(random());
+  }
+}
+
+// A digit times a power of ten, as decompose_amount_into_digits splits amounts
+static uint64_t randomAmount(std::mt19937_64& random) {
+  uint64_t amount = 1 + random() % 9;
+  for (uint64_t power = random() % 14; power > 0; --power) {
+    amount *= 10;
+  }
+
+  return amount;
+}
+
+static void randomOutputs(std::mt19937_64& random, size_t count, cryptonote::transaction& tx) {
+  for (size_t i = 0; i < count; ++i) {
+    cryptonote::txout_to_key target;
+    randomPod(random, target.key);
+    cryptonote::tx_out out;
+    out.amount = randomAmount(random);
+    out.target = target;
+    tx.vout.push_back(out);
+  }
+
+  // Transaction public key
+  tx.extra.push_back(1);
+  for (size_t i = 0; i < 32; ++i) {
+    tx.extra.push_back(static_cast<uint8_t>(random()));
+  }
+}
+
+static cryptonote::transaction randomTransaction(std::mt19937_64& random) {
+  cryptonote::transaction tx;
+  tx.version = 1;
+  size_t inputs = 1 + random() % 6;
+  for (size_t i = 0; i < inputs; ++i) {
+    cryptonote::txin_to_key in;
+    in.amount = randomAmount(random);
+    // Relative offsets, a global index first and small gaps behind it
+    size_t mixin = random() % 6;
+    in.key_offsets.push_back(random() % 3000000);
+    for (size_t j = 0; j < mixin; ++j) {
+      in.key_offsets.push_back(1 + random() % 20000);
+    }
+
+    randomPod(random, in.k_image);
+    tx.vin.push_back(in);
+    tx.signatures.push_back(std::vector<crypto::signature>(mixin + 1));
+    for (crypto::signature& signature : tx.signatures.back()) {
+      randomPod(random, signature);
+    }
+  }
+
+  randomOutputs(random, 2 + random() % 11, tx);
+  return tx;
+}
+
+static cryptonote::block randomBlock(std::mt19937_64& random, size_t height) {
+  cryptonote::block b;
+  b.major_version = BLOCK_MAJOR_VERSION_1;
+  b.minor_version = 0;
+  b.timestamp = 1400000000 + height * 120;
+  randomPod(random, b.prev_id);
+  b.nonce = static_cast<uint32_t>(random());
+  b.miner_tx.version = 1;
+  b.miner_tx.unlock_time = height + 60;
+  cryptonote::txin_gen in;
+  in.height = height;
+  b.miner_tx.vin.push_back(in);
+  randomOutputs(random, 4 + random() % 8, b.miner_tx);
+  b.tx_hashes.resize(random() % 40);
+  for (crypto::hash& hash : b.tx_hashes) {
+    randomPod(random, hash);
+  }
+
+  return b;
+}
+
+// Parses every blob rounds times with parse, then checks that the last results write back unchanged
+template<class T, class Parse>
+static bool timeParsing(const char* name, const std::vector<std::string>& blobs, size_t rounds, Parse parse) {
+  std::vector<T> values(blobs.size());
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (size_t round = 0; round < rounds; ++round) {
+    for (size_t i = 0; i < blobs.size(); ++i) {
+      values[i] = T();
+      if (!parse(blobs[i], values[i])) {
+        std::printf("%s: blob %u not parsed\n", name, static_cast<unsigned>(i));
+        return false;
+      }
+    }
+  }
+
+  std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+  for (size_t i = 0; i < blobs.size(); ++i) {
+    std::string blob;
+    if (!::serialization::dump_binary(values[i], blob) || blob != blobs[i]) {
+      std::printf("%s: blob %u parsed differently\n", name, static_cast<unsigned>(i));
+      return false;
+    }
+  }
+
+  std::printf("%s: %.0f ns per blob\n", name, static_cast<double>(elapsed.count()) / (rounds * blobs.size()));
+  return true;
+}
+
+template<class T>
+static bool compare(const char* spanName, const char* iteratorName, const std::vector<std::string>& blobs, size_t rounds) {
+  // Each twice, in alternating order, so that neither gets the warm caches alone
+  bool success = true;
+  for (int pass = 0; pass < 2; ++pass) {
+    success &= timeParsing<T>(spanName, blobs, rounds, [](const std::string& blob, T& v) { return ::serialization::parse_binary(blob, v); });
+    success &= timeParsing<T>(iteratorName, blobs, rounds, [](const std::string& blob, T& v) { return parseIterator(blob, v); });
+  }
+
+  return success;
+}
+
+int main(int argc, char* argv[]) {
+  size_t rounds = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : DEFAULT_ROUNDS;
+  if (rounds == 0) {
+    std::printf("Usage: VarintBenchmark [<rounds>]\n");
+    return 1;
+  }
+
+  std::mt19937_64 random(0x5eed);
+  std::vector<std::string> blocks;
+  std::vector<std::string> transactions;
+  size_t blockBytes = 0;
+  size_t transactionBytes = 0;
+  for (size_t i = 0; i < BLOCKS; ++i) {
+    cryptonote::block b = randomBlock(random, 500000 + i);
+    blocks.push_back(std::string());
+    ::serialization::dump_binary(b, blocks.back());
+    blockBytes += blocks.back().size();
+  }
+
+  for (size_t i = 0; i < TRANSACTIONS; ++i) {
+    cryptonote::transaction tx = randomTransaction(random);
+    transactions.push_back(std::string());
+    ::serialization::dump_binary(tx, transactions.back());
+    transactionBytes += transactions.back().size();
+  }
+
+  std::printf("%u blocks of %u bytes on average, %u transactions of %u bytes on average, %u rounds\n",
+    static_cast<unsigned>(BLOCKS), static_cast<unsigned>(blockBytes / BLOCKS),
+    static_cast<unsigned>(TRANSACTIONS), static_cast<unsigned>(transactionBytes / TRANSACTIONS), static_cast<unsigned>(rounds));
+  bool success = compare<cryptonote::block>("block span", "block iterator", blocks, rounds);
+  success &= compare<cryptonote::transaction>("transaction span", "transaction iterator", transactions, rounds);
+  return success ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+// Checks read_varint_span and write_varint_span against the iterator based read_varint and write_varint.
+// Built once with the shift fallbacks and once with BMI2 for pext and pdep.
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#include "common/varint.h"
+
+#if defined(__BMI2__)
+static const char* const PATH = "bmi2";
+#else
+static const char* const PATH = "shifts";
+#endif
+
+// Exit code ctest takes for a skipped test
+static const int SKIPPED = 77;
+
+static size_t failures = 0;
+
+static std::string toHex(const uint8_t* data, size_t size) {
+  static const char digits[] = "0123456789abcdef";
+  std::string hex;
+  for (size_t i = 0; i < size; ++i) {
+    hex.push_back(digits[data[i] >> 4]);
+    hex.push_back(digits[data[i] & 0x0F]);
+  }
+
+  return hex;
+}
+
+// Reads the varint at the start of buffer, which has room behind it, with both readers
+template<int bits, typename T>
+static void checkRead(const std::vector<uint8_t>& buffer) {
+  const uint8_t* begin = buffer.data();
+  const uint8_t* end = begin + buffer.size();
+  const uint8_t* expectedFirst = begin;
+  const uint8_t* expectedLast = end;
+  T expected = 0;
+  int expectedResult = tools::read_varint<bits>(expectedFirst, expectedLast, expected);
+  const uint8_t* actualFirst = begin;
+  T actual = 0;
+  int actualResult = tools::read_varint_span<bits>(actualFirst, end, actual);
+  if (actualResult != expectedResult || actualFirst != expectedFirst || actual != expected) {
+    ++failures;
+    std::printf("FAIL read %d bits into %d: %s\n", bits, std::numeric_limits<T>::digits, toHex(begin, buffer.size()).c_str());
+  }
+}
+
+template<typename T>
+static void checkReads(const std::vector<uint8_t>& buffer) {
+  checkRead<std::numeric_limits<T>::digits, T>(buffer);
+  checkRead<std::numeric_limits<T>::digits - 1, T>(buffer);
+}
+
+static void checkAllReads(const std::vector<uint8_t>& buffer) {
+  checkReads<uint8_t>(buffer);
+  checkReads<uint16_t>(buffer);
+  checkReads<uint32_t>(buffer);
+  checkReads<uint64_t>(buffer);
+}
+
+// Every prefix of bytes, so that the reads see truncated input and both sides of the 8-byte fast path
+static void checkPrefixes(const std::vector<uint8_t>& bytes) {
+  for (size_t size = 0; size <= bytes.size(); ++size) {
+    checkAllReads(std::vector<uint8_t>(bytes.begin(), bytes.begin() + size));
+  }
+}
+
+static void checkWrite(uint64_t value) {
+  std::string expected;
+  tools::write_varint(std::back_inserter(expected), value);
+  uint8_t actual[tools::VARINT_MAX_SIZE];
+  size_t size = tools::write_varint_span(actual, value);
+  if (size != expected.size() || memcmp(actual, expected.data(), size) != 0) {
+    ++failures;
+    std::printf("FAIL write %llu\n", static_cast<unsigned long long>(value));
+  }
+}
+
+int main() {
+#if defined(__BMI2__) && defined(__GNUC__)
+  if (!__builtin_cpu_supports("bmi2")) {
+    std::printf("%s: not supported by this CPU\n", PATH);
+    return SKIPPED;
+  }
+
+#endif
+  std::mt19937_64 random(0x5eed);
+  std::vector<uint64_t> values;
+  for (uint64_t value = 0; value < 1 << 16; ++value) {
+    values.push_back(value);
+  }
+
+  for (int bits = 1; bits <= 64; ++bits) {
+    uint64_t top = bits == 64 ? ~static_cast<uint64_t>(0) : (static_cast<uint64_t>(1) << bits) - 1;
+    values.push_back(top);
+    values.push_back(top >> 1 | static_cast<uint64_t>(1) << (bits - 1));
+    for (size_t i = 0; i < 200; ++i) {
+      values.push_back((random() & top) | static_cast<uint64_t>(1) << (bits - 1));
+    }
+  }
+
+  for (uint64_t value : values) {
+    checkWrite(value);
+  }
+
+  // Canonical encodings, values too large for the narrower targets included
+  for (size_t i = 0; i < values.size(); i += 7) {
+    std::vector<uint8_t> bytes;
+    tools::write_varint(std::back_inserter(bytes), values[i]);
+    bytes.resize(bytes.size() + 9, static_cast<uint8_t>(random()));
+    checkPrefixes(bytes);
+  }
+
+  // Non-canonical encodings, a value padded with continuation bytes and a last byte of zero
+  for (int padding = 1; padding <= 9; ++padding) {
+    for (size_t i = 0; i < 50; ++i) {
+      std::vector<uint8_t> bytes;
+      tools::write_varint(std::back_inserter(bytes), values[random() % values.size()] >> (random() % 64));
+      bytes.back() |= 0x80;
+      bytes.insert(bytes.end(), padding - 1, 0x80);
+      bytes.push_back(0);
+      bytes.resize(bytes.size() + 8, 0);
+      checkPrefixes(bytes);
+    }
+  }
+
+  // Random bytes, mostly with the continuation bit so that all sizes up to overlong ones come up
+  for (size_t i = 0; i < 20000; ++i) {
+    std::vector<uint8_t> bytes(16);
+    int continuation = random() % 100;
+    for (uint8_t& byte : bytes) {
+      byte = static_cast<uint8_t>(random());
+      byte = static_cast<int>(random() % 100) < continuation ? byte | 0x80 : byte & 0x7f;
+    }
+
+    checkAllReads(bytes);
+    checkAllReads(std::vector<uint8_t>(bytes.begin(), bytes.begin() + random() % 16));
+  }
+
+  std::printf("%s: %u failures\n", PATH, static_cast<unsigned>(failures));
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,406 @@
+// Stand-in for a CryptoNote daemon, to try the daemon side of SoloMiner without a chain. Serves
+// getblocktemplate, getlastblockheader and submitblock over JSON-RPC, and the portable storage binary
+// forms of getblocktemplate and submitblock at their .bin URIs, with the same serialization as a
+// daemon. A submitted block that meets the difficulty and builds on the tip becomes the new tip,
+// so the miner sees the chain move on.
+//
+//   StandInDaemon <port> [--version <major version>] [--difficulty <difficulty>] [--json-only]
+//                 [--binary-status <status>] [--reject]
+//
+// --version 2 serves merge mined blocks, as an acceptor network does. --json-only answers the .bin
+// URIs with 404, like a daemon without the binary forms, --binary-status answers them with another
+// status, such as a passing 503. --reject turns every submitted block down. Every request is
+// logged with its answer status.
+
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/read_until.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/asio/write.hpp>
+#include "crypto/scratchpad.h"
+#include "cryptonote_core/cryptonote_basic_impl.h"
+#include "cryptonote_core/cryptonote_format_utils.h"
+#include "net/http_server_handlers_map2.h"
+#include "rpc/core_rpc_server_commands_defs.h"
+#include "storages/portable_storage_template_helper.h"
+
+// JSON-RPC error codes of the daemon
+const int64_t ERROR_CODE_INTERNAL_ERROR = -5;
+const int64_t ERROR_CODE_BLOCK_NOT_ACCEPTED = -7;
+const char* const BLOCK_NOT_ACCEPTED = "Block not accepted";
+
+struct Options {
+  uint16_t port;
+  uint8_t majorVersion;
+  cryptonote::difficulty_type difficulty;
+  bool jsonOnly;
+  unsigned int binaryStatus;
+  bool reject;
+};
+
+struct HttpResponse {
+  unsigned int status;
+  std::string contentType;
+  std::string body;
+};
+
+// The tip and height of the chain the daemon makes believe it follows
+class Chain {
+public:
+  explicit Chain(const Options& options);
+  bool makeBlockTemplate(const cryptonote::COMMAND_RPC_GETBLOCKTEMPLATE::request& request, cryptonote::COMMAND_RPC_GETBLOCKTEMPLATE::response* response);
+  // The block becomes the tip if it builds on it and meets the difficulty
+  bool submitBlock(const cryptonote::blobdata& blob);
+  void getLastBlockHeader(cryptonote::block_header_responce* header);
+
+private:
+  const Options& m_options;
+  std::mutex m_mutex;
+  uint64_t m_height;
+  crypto::hash m_tip;
+  crypto::scratchpad m_scratchpad;
+};
+
+Chain::Chain(const Options& options) : m_options(options), m_height(1), m_tip(cryptonote::null_hash) {
+}
+
+bool Chain::makeBlockTemplate(const cryptonote::COMMAND_RPC_GETBLOCKTEMPLATE::request& request, cryptonote::COMMAND_RPC_GETBLOCKTEMPLATE::response* response) {
+  uint64_t prefix;
+  cryptonote::account_public_address address;
+  if (request.reserve_size > 255 || !cryptonote::get_account_address_from_str(prefix, address, request.wallet_address)) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  cryptonote::block block = AUTO_VAL_INIT(block);
+  block.major_version = m_options.majorVersion;
+  block.minor_version = 0;
+  block.timestamp = time(nullptr);
+  block.prev_id = m_tip;
+  block.nonce = 0;
+  if (!cryptonote::construct_miner_tx(m_height, 0, 0, 0, 0, address, block.miner_tx, cryptonote::blobdata(request.reserve_size, '\0'))) {
+    return false;
+  }
+
+  if (block.major_version >= BLOCK_MAJOR_VERSION_2) {
+    block.parent_block.major_version = BLOCK_MAJOR_VERSION_1;
+    block.parent_block.minor_version = 0;
+    block.parent_block.miner_tx = block.miner_tx;
+    block.parent_block.number_of_transactions = 1;
+    cryptonote::tx_extra_merge_mining_tag mergeMiningTag = AUTO_VAL_INIT(mergeMiningTag);
+    if (!cryptonote::append_mm_tag_to_extra(block.parent_block.miner_tx.extra, mergeMiningTag)) {
+      return false;
+    }
+  }
+
+  // The reserved bytes follow the transaction public key, the extra nonce tag and its size
+  cryptonote::blobdata blob = cryptonote::t_serializable_object_to_blob(block);
+  crypto::public_key txPublicKey = cryptonote::get_tx_pub_key_from_extra(block.miner_tx);
+  size_t keyOffset = blob.find(std::string(reinterpret_cast<const char*>(&txPublicKey), sizeof(txPublicKey)));
+  if (keyOffset == std::string::npos) {
+    return false;
+  }
+
+  response->difficulty = m_options.difficulty;
+  response->height = m_height;
+  response->reserved_offset = keyOffset + sizeof(txPublicKey) + 2;
+  response->blocktemplate_blob = blob;
+  response->status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
+bool Chain::submitBlock(const cryptonote::blobdata& blob) {
+  cryptonote::block block;
+  if (m_options.reject || !cryptonote::parse_and_validate_block_from_blob(blob, block)) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (block.prev_id != m_tip) {
+    return false;
+  }
+
+  crypto::hash proofOfWork;
+  bool hashed = block.major_version >= BLOCK_MAJOR_VERSION_2 ? cryptonote::get_bytecoin_block_longhash(block, proofOfWork) : cryptonote::get_block_longhash(block, proofOfWork, m_height, m_scratchpad.data());
+  if (!hashed || !cryptonote::check_hash(proofOfWork, m_options.difficulty)) {
+    return false;
+  }
+
+  m_tip = cryptonote::get_block_hash(block);
+  ++m_height;
+  return true;
+}
+
+void Chain::getLastBlockHeader(cryptonote::block_header_responce* header) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  header->major_version = m_options.majorVersion;
+  header->minor_version = 0;
+  header->timestamp = time(nullptr);
+  header->prev_hash = epee::string_tools::pod_to_hex(cryptonote::null_hash);
+  header->nonce = 0;
+  header->orphan_status = false;
+  header->height = m_height - 1;
+  header->depth = 0;
+  header->hash = epee::string_tools::pod_to_hex(m_tip);
+  header->difficulty = m_options.difficulty;
+  header->reward = 0;
+}
+
+static HttpResponse makeResponse(unsigned int status, const std::string& contentType, const std::string& body) {
+  HttpResponse response = { status, contentType, body };
+  return response;
+}
+
+// Answers a JSON-RPC request of Command with handler, which gives an error code and message for a failure
+template<class Command, class Handler> static HttpResponse answerJsonRpc(const std::string& body, Handler handler) {
+  epee::json_rpc::request<typename Command::request> request = AUTO_VAL_INIT(request);
+  if (!epee::serialization::load_t_from_json(request, body)) {
+    return makeResponse(400, "text/plain", "Malformed request");
+  }
+
+  epee::json_rpc::response<typename Command::response, epee::json_rpc::dummy_error> response = AUTO_VAL_INIT(response);
+  epee::json_rpc::error error = AUTO_VAL_INIT(error);
+  std::string answer;
+  if (handler(request.params, &response.result, &error)) {
+    response.jsonrpc = "2.0";
+    response.id = request.id;
+    epee::serialization::store_t_to_json(response, answer);
+  } else {
+    epee::json_rpc::error_response errorResponse = AUTO_VAL_INIT(errorResponse);
+    errorResponse.jsonrpc = "2.0";
+    errorResponse.id = request.id;
+    errorResponse.error = error;
+    epee::serialization::store_t_to_json(errorResponse, answer);
+  }
+
+  return makeResponse(200, "application/json", answer);
+}
+
+// Answers a binary request of Command with handler, which sets the status of the response
+template<class Command, class Handler> static HttpResponse answerBinary(const std::string& body, Handler handler) {
+  typename Command::request request = AUTO_VAL_INIT(request);
+  if (!epee::serialization::load_t_from_binary(request, body)) {
+    return makeResponse(400, "text/plain", "Malformed request");
+  }
+
+  typename Command::response response = AUTO_VAL_INIT(response);
+  handler(request, &response);
+  std::string answer;
+  epee::serialization::store_t_to_binary(response, answer);
+  return makeResponse(200, "application/octet-stream", answer);
+}
+
+static HttpResponse handleRequest(Chain& chain, const Options& options, const std::string& uri, const std::string& body) {
+  if (uri == CORE_RPC_GETBLOCKTEMPLATE_BIN_URI || uri == CORE_RPC_SUBMITBLOCK_BIN_URI) {
+    if (options.jsonOnly) {
+      return makeResponse(404, "text/plain", "Not found");
+    }
+
+    if (options.binaryStatus != 200) {
+      return makeResponse(options.binaryStatus, "text/plain", "Stand-in error");
+    }
+
+    if (uri == CORE_RPC_GETBLOCKTEMPLATE_BIN_URI) {
+      return answerBinary<cryptonote::COMMAND_RPC_GETBLOCKTEMPLATE_BIN>(body, [&chain](const cryptonote::COMMAND_RPC_GETBLOCKTEMPLATE_BIN::request& request, cryptonote::COMMAND_RPC_GETBLOCKTEMPLATE_BIN::response* response) {
+        if (!chain.makeBlockTemplate(request, response)) {
+          response->status = "Failed to create block template";
+        }
+      });
+    }
+
+    return answerBinary<cryptonote::COMMAND_RPC_SUBMITBLOCK_BIN>(body, [&chain](const cryptonote::COMMAND_RPC_SUBMITBLOCK_BIN::request& request, cryptonote::COMMAND_RPC_SUBMITBLOCK_BIN::response* response) {
+      response->status = chain.submitBlock(request.block_blob) ? CORE_RPC_STATUS_OK : BLOCK_NOT_ACCEPTED;
+    });
+  }
+
+  if (uri != "/json_rpc") {
+    return makeResponse(404, "text/plain", "Not found");
+  }
+
+  epee::serialization::portable_storage storage;
+  std::string method;
+  if (!storage.load_from_json(body) || !storage.get_value("method", method, nullptr)) {
+    return makeResponse(400, "text/plain", "Malformed request");
+  }
+
+  if (method == "getblocktemplate") {
+    return answerJsonRpc<cryptonote::COMMAND_RPC_GETBLOCKTEMPLATE>(body, [&chain](const cryptonote::COMMAND_RPC_GETBLOCKTEMPLATE::request& request, cryptonote::COMMAND_RPC_GETBLOCKTEMPLATE::response* response, epee::json_rpc::error* error) {
+      if (!chain.makeBlockTemplate(request, response)) {
+        error->code = ERROR_CODE_INTERNAL_ERROR;
+        error->message = "Internal error: failed to create block template";
+        return false;
+      }
+
+      response->blocktemplate_blob = epee::string_tools::buff_to_hex_nodelimer(response->blocktemplate_blob);
+      return true;
+    });
+  }
+
+  if (method == "submitblock") {
+    return answerJsonRpc<cryptonote::COMMAND_RPC_SUBMITBLOCK>(body, [&chain](const cryptonote::COMMAND_RPC_SUBMITBLOCK::request& request, cryptonote::COMMAND_RPC_SUBMITBLOCK::response* response, epee::json_rpc::error* error) {
+      cryptonote::blobdata blob;
+      if (request.size() != 1 || !epee::string_tools::parse_hexstr_to_binbuff(request[0], blob) || !chain.submitBlock(blob)) {
+        error->code = ERROR_CODE_BLOCK_NOT_ACCEPTED;
+        error->message = BLOCK_NOT_ACCEPTED;
+        return false;
+      }
+
+      response->status = CORE_RPC_STATUS_OK;
+      return true;
+    });
+  }
+
+  if (method == "getlastblockheader") {
+    return answerJsonRpc<cryptonote::COMMAND_RPC_GET_LAST_BLOCK_HEADER>(body, [&chain](const cryptonote::COMMAND_RPC_GET_LAST_BLOCK_HEADER::request& request, cryptonote::COMMAND_RPC_GET_LAST_BLOCK_HEADER::response* response, epee::json_rpc::error* error) {
+      chain.getLastBlockHeader(&response->block_header);
+      response->status = CORE_RPC_STATUS_OK;
+      return true;
+    });
+  }
+
+  return makeResponse(404, "text/plain", "Unknown method");
+}
+
+static const char* getReasonPhrase(unsigned int status) {
+  switch (status) {
+  case 200:
+    return "OK";
+  case 400:
+    return "Bad Request";
+  case 404:
+    return "Not Found";
+  case 405:
+    return "Method Not Allowed";
+  case 500:
+    return "Internal Server Error";
+  case 502:
+    return "Bad Gateway";
+  case 503:
+    return "Service Unavailable";
+  default:
+    return "Error";
+  }
+}
+
+static std::mutex logMutex;
+
+// Answers the requests of one keep-alive connection in turn
+static void serveConnection(std::shared_ptr<boost::asio::ip::tcp::socket> socket, Chain* chain, const Options* options) {
+  boost::asio::streambuf buffer;
+  boost::system::error_code error;
+  for (;;) {
+    size_t headerSize = boost::asio::read_until(*socket, buffer, "\r\n\r\n", error);
+    if (error) {
+      return;
+    }
+
+    std::string header(boost::asio::buffers_begin(buffer.data()), boost::asio::buffers_begin(buffer.data()) + headerSize);
+    buffer.consume(headerSize);
+    std::istringstream headerStream(header);
+    std::string method;
+    std::string uri;
+    std::string line;
+    headerStream >> method >> uri;
+    std::getline(headerStream, line);
+    size_t contentLength = 0;
+    bool close = false;
+    while (std::getline(headerStream, line)) {
+      size_t colon = line.find(':');
+      if (colon == std::string::npos) {
+        continue;
+      }
+
+      std::string name = boost::algorithm::to_lower_copy(line.substr(0, colon));
+      std::string value = boost::algorithm::trim_copy(line.substr(colon + 1));
+      if (name == "content-length") {
+        contentLength = static_cast<size_t>(strtoull(value.c_str(), nullptr, 10));
+      } else if (name == "connection") {
+        close = boost::algorithm::to_lower_copy(value) == "close";
+      }
+    }
+
+    if (buffer.size() < contentLength) {
+      boost::asio::read(*socket, buffer, boost::asio::transfer_exactly(contentLength - buffer.size()), error);
+      if (error) {
+        return;
+      }
+    }
+
+    std::string body(boost::asio::buffers_begin(buffer.data()), boost::asio::buffers_begin(buffer.data()) + contentLength);
+    buffer.consume(contentLength);
+    HttpResponse response = handleRequest(*chain, *options, uri, body);
+    {
+      std::lock_guard<std::mutex> lock(logMutex);
+      std::cout << method << ' ' << uri << ' ' << response.status << std::endl;
+    }
+
+    std::ostringstream responseStream;
+    responseStream << "HTTP/1.1 " << response.status << ' ' << getReasonPhrase(response.status) << "\r\n";
+    responseStream << "Content-Type: " << response.contentType << "\r\n";
+    responseStream << "Content-Length: " << response.body.size() << "\r\n";
+    if (close) {
+      responseStream << "Connection: close\r\n";
+    }
+
+    responseStream << "\r\n" << response.body;
+    boost::asio::write(*socket, boost::asio::buffer(responseStream.str()), error);
+    if (error || close) {
+      return;
+    }
+  }
+}
+
+static bool parseOptions(int argc, char* argv[], Options* options) {
+  if (argc < 2) {
+    return false;
+  }
+
+  options->port = static_cast<uint16_t>(atoi(argv[1]));
+  for (int i = 2; i < argc; ++i) {
+    std::string option(argv[i]);
+    if (option == "--json-only") {
+      options->jsonOnly = true;
+    } else if (option == "--reject") {
+      options->reject = true;
+    } else if (i + 1 < argc && option == "--version") {
+      options->majorVersion = static_cast<uint8_t>(atoi(argv[++i]));
+    } else if (i + 1 < argc && option == "--difficulty") {
+      options->difficulty = strtoull(argv[++i], nullptr, 10);
+    } else if (i + 1 < argc && option == "--binary-status") {
+      options->binaryStatus = static_cast<unsigned int>(atoi(argv[++i]));
+    } else {
+      return false;
+    }
+  }
+
+  return options->port != 0 && options->difficulty != 0 && (options->majorVersion == BLOCK_MAJOR_VERSION_1 || options->majorVersion == BLOCK_MAJOR_VERSION_2);
+}
+
+int main(int argc, char* argv[]) {
+  Options options = { 0, BLOCK_MAJOR_VERSION_1, 100, false, 200, false };
+  if (!parseOptions(argc, argv, &options)) {
+    std::cerr << "Usage: StandInDaemon <port> [--version <major version>] [--difficulty <difficulty>] [--json-only] [--binary-status <status>] [--reject]" << std::endl;
+    return 1;
+  }
+
+  Chain chain(options);
+  boost::asio::io_service ioService;
+  boost::asio::ip::tcp::acceptor acceptor(ioService, boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), options.port));
+  std::cout << "Serving version " << static_cast<unsigned int>(options.majorVersion) << " blocks of difficulty " << options.difficulty << " on 127.0.0.1:" << options.port << std::endl;
+  for (;;) {
+    std::shared_ptr<boost::asio::ip::tcp::socket> socket = std::make_shared<boost::asio::ip::tcp::socket>(ioService);
+    acceptor.accept(*socket);
+    std::thread(serveConnection, socket, &chain, &options).detach();
+  }
+}